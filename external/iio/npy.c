@@ -107,26 +107,14 @@ static const char *iio_strtyp(int type)
 }
 
 
-int npy_read_header(FILE *fin, struct npy_info* ni)
+// parse the dictionary of the header, ni->header_offset is not set
+static int parse_header_dict(const char *npy_header, struct npy_info* ni)
 {
-	// tag + fixed-size header
-	char s[10];
-	if (fread(s, 1, 10, fin) != 10)
-		return 0;
-	if (s[6] != 1 || s[7] != 0)
-		return fprintf(stderr, "only NPY 1.0 is supported\n"), 0;
-
-	// variable-size header
-	int npy_header_size = s[8] + 0x100 * s[9];
-	char npy_header[npy_header_size];
-	if (fread(npy_header, 1, npy_header_size, fin) != npy_header_size)
-		return 0;
-
 	// extract fields from the npy header
 	char descr[10];
 	char order[10];
 	int n;
-	n = sscanf(npy_header, "{'descr': '%[^']', 'fortran_order': %[^,],"
+	n = sscanf(npy_header, "{'descr': '%9[^']', 'fortran_order': %9[^,],"
 			" 'shape': (%zu, %zu, %zu, %zu", descr, order,
 			ni->dims+0, ni->dims+1, ni->dims+2, ni->dims+3);
 	if (n < 3) return fprintf(stderr, "badly formed npy header\n"), 0;
@@ -140,6 +128,7 @@ int npy_read_header(FILE *fin, struct npy_info* ni)
 	if (false) ;
 	else if (0 == strcmp(desc, "f8")) type = IIO_TYPE_DOUBLE;
 	else if (0 == strcmp(desc, "f4")) type = IIO_TYPE_FLOAT;
+	else if (0 == strcmp(desc, "f2")) type = IIO_TYPE_HALF;
 	else if (0 == strcmp(desc, "b1")) type = IIO_TYPE_UINT8;
 	else if (0 == strcmp(desc, "u1")) type = IIO_TYPE_UINT8;
 	else if (0 == strcmp(desc, "u2")) type = IIO_TYPE_UINT16;
@@ -153,11 +142,55 @@ int npy_read_header(FILE *fin, struct npy_info* ni)
 	else if (0 == strcmp(desc, "c16")) type = IIO_TYPE_DOUBLE;
 	else return fprintf(stderr,
 			"IIO ERROR: unrecognized npy type \"%s\"\n", desc), 0;
+	if (*desc == 'c' && ni->ndims == 4)
+		return fprintf(stderr, "IIO ERROR: too many dimensions for complex npy\n"), 0;
 	if (*desc == 'c') ni->dims[ni->ndims++] = 2; // 1 complex = 2 reals
 
 	strncpy(ni->desc, descr, 10);
 	ni->type = type;
 	ni->fortran_order = order[0] == 'T';
+	return 1;
+}
+
+int npy_read_header(FILE *fin, struct npy_info* ni)
+{
+	// tag + fixed-size header
+	char s[10];
+	if (fread(s, 1, 10, fin) != 10)
+		return 0;
+	if (s[6] != 1 || s[7] != 0)
+		return fprintf(stderr, "only NPY 1.0 is supported\n"), 0;
+
+	// variable-size header
+	int npy_header_size = (unsigned char)s[8] + 0x100 * (unsigned char)s[9];
+	char npy_header[npy_header_size + 1];
+	if (fread(npy_header, 1, npy_header_size, fin) != npy_header_size)
+		return 0;
+	npy_header[npy_header_size] = 0;
+
+	if (!parse_header_dict(npy_header, ni))
+		return 0;
+	ni->header_offset = 10 + npy_header_size;
+	return 1;
+}
+
+int npy_parse_header(const void *data, size_t size, struct npy_info* ni)
+{
+	const unsigned char *s = data;
+	if (size < 10 || memcmp(s, "\x93NUMPY", 6))
+		return 0;
+	if (s[6] != 1 || s[7] != 0)
+		return fprintf(stderr, "only NPY 1.0 is supported\n"), 0;
+
+	int npy_header_size = s[8] + 0x100 * s[9];
+	if (size < 10 + (size_t)npy_header_size)
+		return 0;
+	char npy_header[npy_header_size + 1];
+	memcpy(npy_header, s + 10, npy_header_size);
+	npy_header[npy_header_size] = 0;
+
+	if (!parse_header_dict(npy_header, ni))
+		return 0;
 	ni->header_offset = 10 + npy_header_size;
 	return 1;
 }
@@ -12,6 +12,8 @@ struct npy_info {
 };
 
 int npy_read_header(FILE *fin, struct npy_info* ni);
+// header at the beginning of data (at least 10 bytes, plus the size of the header)
+int npy_parse_header(const void *data, size_t size, struct npy_info* ni);
 size_t npy_type_size(int type);
 float* npy_convert_to_float(void* src, int n, int src_fmt);
 
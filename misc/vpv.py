@@ -1,56 +1,278 @@
 #!/usr/bin/env python3
 # coding: utf-8
 
+import ctypes
 import os
+import platform
+import shlex
+import struct
 import sys
 import tempfile
 import numpy as np
 
+# slots of a ring: an array of n frames is pushed to at least n + 1 slots, so that vpv can copy all of them
+SHM_SLOTS = 8
+# arrays needing a larger ring are given to vpv as .npy files
+SHM_MAX_BYTES = 1 << 30
+
+# layout of the shared memory rings read by vpv (shm:<name>), see src/ImageCollection.cpp
+SHM_MAGIC = b'VPVSHM1\0'
+SHM_HEADER = 64
+SHM_SLOT_HEADER = 64
+
+SYS_FUTEX = {'x86_64': 202, 'aarch64': 98, 'arm64': 98}.get(platform.machine())
+FUTEX_WAKE = 1
+libc = ctypes.CDLL(None)
+
+
+def sampletype(dtype):
+    ''' type of the samples as given to raw: (u8, i16, f32be...), None if vpv can't read them '''
+    if dtype.kind not in 'uif' or dtype.itemsize > 8:
+        return None
+    t = dtype.kind + str(dtype.itemsize * 8)
+    if dtype.byteorder == '>' or (dtype.byteorder == '=' and sys.byteorder == 'big'):
+        t += 'be'
+    return t
+
+
+def frames(o):
+    ''' frames of shape (height, width, channels) of an array of shape ([nframes, ]height, width[, nchannels]) '''
+    if o.dtype == bool:
+        o = o.astype(np.uint8)
+    if sampletype(o.dtype) is None:
+        o = o.astype(np.float32)
+    # same heuristic as vpv for the .npy files
+    if o.ndim == 2:
+        o = o[None, :, :, None]
+    elif o.ndim == 3 and o.shape[2] < o.shape[0] and o.shape[2] < o.shape[1]:
+        o = o[None]
+    elif o.ndim == 3:
+        o = o[:, :, :, None]
+    elif o.ndim != 4:
+        raise ValueError('unsupported shape {}'.format(o.shape))
+    return [np.ascontiguousarray(f) for f in o]
+
+
+def ringsize(frames):
+    ''' slots and size of a slot of the ring needed to push the frames '''
+    slotsize = (SHM_SLOT_HEADER + max((f.nbytes for f in frames), default=0) + 63) // 64 * 64
+    return max(SHM_SLOTS, len(frames) + 1), slotsize
+
+
+def fits(frames):
+    slots, slotsize = ringsize(frames)
+    return SHM_HEADER + slots * slotsize <= SHM_MAX_BYTES
+
+
+def untrack(shm):
+    ''' the segments outlive this process: they are unlinked when vpv exits (see openwindow) '''
+    try:
+        from multiprocessing import resource_tracker
+        resource_tracker.unregister(shm._name, 'shared_memory')
+    except Exception:
+        pass
+
+
+def unlink(name):
+    try:
+        import _posixshmem
+        _posixshmem.shm_unlink('/' + name)
+    except (ImportError, OSError):
+        pass
+
+
+class Ring:
+    ''' shared memory segment holding the last frames pushed to a sequence '''
+
+    def __init__(self, name):
+        self.name = name
+        self.shm = None
+        self.slots = 0
+        self.written = 0
+
+    @classmethod
+    def attach(cls, name):
+        ''' ring created by an earlier call (possibly of another process), None if there is none '''
+        from multiprocessing import shared_memory
+        try:
+            shm = shared_memory.SharedMemory(name=name)
+        except FileNotFoundError:
+            return None
+        untrack(shm)
+        ring = cls(name)
+        ring.shm = shm
+        ring.slots, = struct.unpack_from('<I', shm.buf, 8)
+        ring.written, = struct.unpack_from('<Q', shm.buf, 24)
+        return ring
+
+    def create(self, slots, slotsize):
+        from multiprocessing import shared_memory
+        old = self.shm
+        # a segment left by a vpv which did not exit normally
+        unlink(self.name)
+        self.shm = shared_memory.SharedMemory(name=self.name, create=True,
+                                              size=SHM_HEADER + slots * slotsize)
+        untrack(self.shm)
+        self.slots = slots
+        buf = self.shm.buf
+        struct.pack_into('<IIQQI', buf, 8, slots, 0, slotsize, 0, 0)
+        # the magic comes last, vpv ignores the segment until then
+        buf[0:8] = SHM_MAGIC
+        self.written = 0
+        if old is not None:
+            # vpv opens the new segment, and numbers its frames after those of the old one
+            struct.pack_into('<I', old.buf, 12, 1)
+            self.notify(old)
+            old.close()
+
+    def close(self):
+        ''' closes the mapping of this process, vpv still reads the segment '''
+        if self.shm is not None:
+            self.shm.close()
+            self.shm = None
+
+    def notify(self, shm):
+        count, = struct.unpack_from('<I', shm.buf, 32)
+        struct.pack_into('<I', shm.buf, 32, (count + 1) & 0xffffffff)
+        if SYS_FUTEX is not None:
+            word = ctypes.c_uint32.from_buffer(shm.buf, 32)
+            libc.syscall(ctypes.c_long(SYS_FUTEX), ctypes.c_void_p(ctypes.addressof(word)),
+                         ctypes.c_int(FUTEX_WAKE), ctypes.c_int(0x7fffffff), None, None, ctypes.c_int(0))
+            del word
+
+    def push(self, frames):
+        ''' pushes the frames of an array, the ring is replaced by a larger one if they don't fit in it '''
+        slots, slotsize = ringsize(frames)
+        if self.shm is None or slots > self.slots or slotsize > self.slotsize():
+            self.create(max(slots, self.slots), max(slotsize, self.slotsize() if self.shm else 0))
+        for f in frames:
+            self.pushframe(f)
+
+    def pushframe(self, frame):
+        nbytes = frame.nbytes
+        buf = self.shm.buf
+        i = self.written
+        slot = SHM_HEADER + i % self.slots * self.slotsize()
+        struct.pack_into('<Q', buf, slot, 2**64 - 1)
+        h, w, c = frame.shape
+        struct.pack_into('<III8s', buf, slot + 8, h, w, c, sampletype(frame.dtype).encode())
+        data = slot + SHM_SLOT_HEADER
+        buf[data:data + nbytes] = frame.reshape(-1).view(np.uint8)
+        struct.pack_into('<Q', buf, slot, i)
+        self.written = i + 1
+        struct.pack_into('<Q', buf, 24, self.written)
+        self.notify(self.shm)
+
+    def slotsize(self):
+        return struct.unpack_from('<Q', self.shm.buf, 16)[0]
+
+
+def ringname(num, j):
+    return 'vpv-{}-{}-{}'.format(os.getuid(), num, j)
+
+
+def openwindow(num, dir, args):
+    '''
+        the sequences of the window are rings, or .npy files in dir for the arrays too large for a ring
+        (watched by vpv); they are removed when vpv exits, as is dir which tells that the window is open
+    '''
+    os.makedirs(dir)
+    cmd = 'vpv'
+    rings = []
+    watch = False
+    j = 1
+    for o in args:
+        if isinstance(o, str):
+            cmd += ' ' + o
+            continue
+        fs = frames(o)
+        if fits(fs):
+            ring = Ring(ringname(num, j))
+            ring.push(fs)
+            ring.close()
+            rings.append(ring.name)
+            cmd += ' shm:' + ring.name
+        else:
+            name = '{}/{}.npy'.format(dir, j)
+            np.save(name, o)
+            watch = True
+            cmd += ' ' + name
+        j += 1
+    if watch:
+        cmd = 'env WATCH=1 ' + cmd
+
+    cleanup = ' '.join(shlex.quote(a) for a in [sys.executable, os.path.abspath(__file__), '--unlink'] + rings)
+    cmd = '({}; rm -rf "{}"; {}) &'.format(cmd, dir, cleanup)
+    print(cmd)
+    os.system(cmd)
+
+
+def updatewindow(num, dir, args):
+    j = 1
+    for o in args:
+        if isinstance(o, str):
+            continue
+        name = '{}/{}.npy'.format(dir, j)
+        j += 1
+        if os.path.exists(name):
+            # vpv reloads it (WATCH)
+            np.save(name, o)
+            continue
+        ring = Ring.attach(ringname(num, j - 1))
+        fs = frames(o)
+        if ring is None:
+            print('vpv #', num, ': no sequence', j - 1, 'to update')
+        elif not fits(fs):
+            print('vpv #', num, ': array', j - 1, 'is too large to be pushed, not updated')
+        else:
+            ring.push(fs)
+        if ring is not None:
+            ring.close()
+    print('vpv #', num, ' updated.')
+
 
 def vpv(*args):
     '''
         *args should be a list containing numpy arrays or strings
         arrays should be of shape ([nframes, ]height, width[, nchannels])
         torch.Tensor as converted as numpy arrays of the same shape
+
+        vpv(num, *args) shows the arrays in the window number num, the next calls
+        with the same number (from any process, while the window is open) push their arrays
+        to it as new frames, through shared memory
     '''
-    cmd = 'vpv'
-    dir = os.path.join(tempfile.gettempdir(), 'vpvpython')
+    args = [o.cpu().detach().numpy() if type(o).__module__ == 'torch' else o for o in args]
 
-    if args and isinstance(args[0], int):
+    if args and isinstance(args[0], int) and os.name == 'posix':
         num = args[0]
-        dir = dir + '_' + str(num)
-        cmd = 'env WATCH=1 ' + cmd
-        args = args[1:]
-        isnumbered = True
-    else:
-        isnumbered = False
-
-    if not os.path.exists(dir):
-        os.makedirs(dir)
-        newwindow = True
-    else:
-        newwindow = False
+        dir = os.path.join(tempfile.gettempdir(), 'vpvpython_{}'.format(num))
+        if os.path.exists(dir):
+            updatewindow(num, dir, args[1:])
+        else:
+            openwindow(num, dir, args[1:])
+        return
 
+    cmd = 'vpv'
+    dir = tempfile.mkdtemp(prefix='vpvpython')
     j = 1
     for o in args:
-        if type(o).__module__ is 'torch':
-            o = o.cpu().detach().numpy()
-
         if isinstance(o, str):
             cmd += ' ' + o
-        else:
+        elif not isinstance(o, int):
             name = '{}/{}.npy'.format(dir, j)
             np.save(name, o)
             cmd = cmd + ' ' + name
             j += 1
 
     cmd = '({}; rm -rf "{}") &'.format(cmd, dir)
-    if not isnumbered or newwindow:
-        print(cmd)
-        os.system(cmd)
-    elif isnumbered:
-        print('vpv #', num, ' updated.')
+    print(cmd)
+    os.system(cmd)
+
 
+if __name__ == '__main__' and sys.argv[1:2] == ['--unlink']:
+    # run once the vpv of a numbered window exits
+    for name in sys.argv[2:]:
+        unlink(name)
 
 # make so the vpv module is callable
 sys.modules[__name__] = vpv
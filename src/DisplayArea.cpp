@@ -29,10 +29,11 @@ void DisplayArea::draw(const std::shared_ptr<Image>& image, ImVec2 pos, ImVec2 w
 
     // update the texture if we have an image
     if (image) {
-        ImVec2 imSize(image->w, image->h);
-        ImVec2 p1 = view.window2image(ImVec2(0, 0), imSize, winSize, factor);
-        ImVec2 p2 = view.window2image(winSize, imSize, winSize, factor);
-        requestTextureArea(image, ImRect(p1, p2), colormap.bands);
+        ImVec2 p1 = view.window2image(ImVec2(0, 0), image->size, winSize, factor);
+        ImVec2 p2 = view.window2image(winSize, image->size, winSize, factor);
+        // previews have less pixels than the area they cover
+        ImVec2 scale = ImVec2(image->w, image->h) / image->size;
+        requestTextureArea(image, ImRect(p1 * scale, p2 * scale), colormap.bands);
     }
 
     // draw a checkboard pattern
@@ -52,9 +53,13 @@ void DisplayArea::draw(const std::shared_ptr<Image>& image, ImVec2 pos, ImVec2 w
     userdata->scale = colormap.getScale();
     userdata->bias = colormap.getBias();
     ImGui::GetWindowDrawList()->AddCallback(ImGui::SetShaderCallback, userdata);
+    ImVec2 scale(1, 1);
+    if (this->image) {
+        scale = this->image->size / ImVec2(this->image->w, this->image->h);
+    }
     for (auto t : texture.tiles) {
-        ImVec2 TL = view.image2window(ImVec2(t.x, t.y), getCurrentSize(), winSize, factor);
-        ImVec2 BR = view.image2window(ImVec2(t.x + t.w, t.y + t.h), getCurrentSize(), winSize, factor);
+        ImVec2 TL = view.image2window(ImVec2(t.x, t.y) * scale, getCurrentSize(), winSize, factor);
+        ImVec2 BR = view.image2window(ImVec2(t.x + t.w, t.y + t.h) * scale, getCurrentSize(), winSize, factor);
 
         TL += pos;
         BR += pos;
@@ -84,6 +89,7 @@ void DisplayArea::requestTextureArea(const std::shared_ptr<Image>& image, ImRect
     if (this->image != image) {
         this->image = image;
         loadedRect = ImRect();
+        loadedRows = 0;
         reupload = true;
     }
 
@@ -99,15 +105,28 @@ void DisplayArea::requestTextureArea(const std::shared_ptr<Image>& image, ImRect
         reupload = true;
     }
 
+    // provisional images are uploaded incrementally, as their rows get decoded
+    size_t rows = image->getValidRows();
     if (reupload) {
-        texture.upload(*image, loadedRect, loadedBands);
+        ImRect area = loadedRect;
+        area.Max.y = std::max(area.Min.y, std::min(area.Max.y, (float)rows));
+        texture.upload(*image, area, loadedBands);
+        loadedRows = rows;
+    } else if (rows > loadedRows) {
+        ImRect area = loadedRect;
+        area.Min.y = std::max(area.Min.y, (float)loadedRows);
+        area.Max.y = std::min(area.Max.y, (float)rows);
+        if (area.Max.y > area.Min.y) {
+            texture.upload(*image, area, loadedBands);
+        }
+        loadedRows = rows;
     }
 }
 
 ImVec2 DisplayArea::getCurrentSize() const
 {
     if (image) {
-        return ImVec2(image->w, image->h);
+        return image->size;
     }
     return ImVec2();
 }
@@ -16,11 +16,13 @@ class DisplayArea {
     std::shared_ptr<Image> image;
     ImRect loadedRect;
     BandIndices loadedBands;
+    size_t loadedRows;
 
 public:
     DisplayArea()
         : image(nullptr)
         , loadedBands(BANDS_DEFAULT)
+        , loadedRows(0)
     {
     }
 
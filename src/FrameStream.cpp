@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "FrameStream.hpp"
+#include "ImageCollection.hpp"
+#include "ImageProvider.hpp"
+
+FrameStream::FrameStream(size_t depth)
+    : slots(std::max<size_t>(depth, 1), Slot { -1, nullptr })
+    , hits(0)
+    , misses(0)
+{
+}
+
+FrameStream::Slot* FrameStream::findSlot(int index)
+{
+    for (auto& slot : slots) {
+        if (slot.index == index) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<ImageProvider> FrameStream::makeProvider(const std::shared_ptr<ImageCollection>& collection, int index)
+{
+    std::shared_ptr<ImageProvider> provider = collection->getImageProvider(index);
+    auto cached = std::dynamic_pointer_cast<CacheImageProvider>(provider);
+    if (cached && !cached->isLoaded()) {
+        return cached->makeUncached();
+    }
+    return provider;
+}
+
+void FrameStream::update(const std::shared_ptr<ImageCollection>& newCollection, const std::vector<int>& indices)
+{
+    std::lock_guard<std::mutex> _lock(mutex);
+    if (newCollection != collection) {
+        collection = newCollection;
+        for (auto& slot : slots) {
+            slot = Slot { -1, nullptr };
+        }
+    }
+
+    order.clear();
+    for (int index : indices) {
+        if (order.size() == slots.size())
+            break;
+        if (std::find(order.begin(), order.end(), index) == order.end()) {
+            order.push_back(index);
+        }
+    }
+
+    // recycle the slots of the frames which won't be played soon
+    for (auto& slot : slots) {
+        if (std::find(order.begin(), order.end(), slot.index) == order.end()) {
+            slot = Slot { -1, nullptr };
+        }
+    }
+    for (int index : order) {
+        if (findSlot(index))
+            continue;
+        Slot* free = findSlot(-1);
+        free->index = index;
+    }
+}
+
+std::shared_ptr<ImageProvider> FrameStream::getImageProvider(int index)
+{
+    std::unique_lock<std::mutex> lk(mutex);
+    Slot* slot = findSlot(index);
+    if (slot && slot->provider) {
+        if (slot->provider->isLoaded()) {
+            hits++;
+        } else {
+            misses++;
+        }
+        return slot->provider;
+    }
+    misses++;
+    std::shared_ptr<ImageCollection> c = collection;
+    lk.unlock();
+
+    std::shared_ptr<ImageProvider> provider = makeProvider(c, index);
+
+    lk.lock();
+    slot = findSlot(index);
+    if (slot && !slot->provider && c == collection) {
+        slot->provider = provider;
+    }
+    return provider;
+}
+
+std::shared_ptr<ImageProvider> FrameStream::getNextToLoad()
+{
+    std::unique_lock<std::mutex> lk(mutex);
+    // the order can change while the lock is released, hence the index
+    for (size_t i = 0; i < order.size(); i++) {
+        int index = order[i];
+        Slot* slot = findSlot(index);
+        if (!slot->provider) {
+            // creating a provider can open the file, don't block the main thread meanwhile
+            std::shared_ptr<ImageCollection> c = collection;
+            lk.unlock();
+            std::shared_ptr<ImageProvider> provider = makeProvider(c, index);
+            lk.lock();
+            slot = findSlot(index);
+            if (!slot || c != collection) {
+                // the frame left the stream in the meantime
+                continue;
+            }
+            if (!slot->provider) {
+                slot->provider = provider;
+            }
+        }
+        if (canProgress(slot->provider)) {
+            return slot->provider;
+        }
+    }
+    return nullptr;
+}
+
+bool FrameStream::isLoaded(int index) const
+{
+    std::lock_guard<std::mutex> _lock(mutex);
+    for (const auto& slot : slots) {
+        if (slot.index == index && slot.provider && slot.provider->isLoaded()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> FrameStream::getPendingFilenames() const
+{
+    std::lock_guard<std::mutex> _lock(mutex);
+    std::vector<std::string> filenames;
+    for (int index : order) {
+        for (const auto& slot : slots) {
+            if (slot.index == index && (!slot.provider || !slot.provider->isLoaded())
+                && collection->isWholeFile(index)) {
+                filenames.push_back(collection->getFilename(index));
+            }
+        }
+    }
+    return filenames;
+}
+
+void FrameStream::flush()
+{
+    std::lock_guard<std::mutex> _lock(mutex);
+    for (auto& slot : slots) {
+        slot.provider = nullptr;
+    }
+}
+
+FrameStream::Stats FrameStream::getStats() const
+{
+    std::lock_guard<std::mutex> _lock(mutex);
+    Stats stats { slots.size(), 0, hits, misses };
+    for (const auto& slot : slots) {
+        if (slot.provider && slot.provider->isLoaded()) {
+            stats.ready++;
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ImageCollection;
+class ImageProvider;
+
+// Streaming playback of a sequence: the frames that will be played next are loaded in play order
+// into a fixed number of slots, which are recycled as the playback advances.
+// The images do not go through the ImageCache, which is useless for sequences much larger than it
+// (every frame is evicted before being shown again) and would evict the frames of the other sequences.
+class FrameStream {
+public:
+    struct Stats {
+        size_t depth; // number of slots
+        size_t ready; // slots whose frame is loaded
+        size_t hits; // displayed frames which were loaded in advance
+        size_t misses; // displayed frames which were not
+    };
+
+private:
+    struct Slot {
+        int index;
+        std::shared_ptr<ImageProvider> provider;
+    };
+
+    mutable std::mutex mutex;
+    std::shared_ptr<ImageCollection> collection;
+    std::vector<Slot> slots;
+    // indices of the collection, in play order
+    std::vector<int> order;
+    size_t hits;
+    size_t misses;
+
+    Slot* findSlot(int index);
+    static std::shared_ptr<ImageProvider> makeProvider(const std::shared_ptr<ImageCollection>& collection, int index);
+
+public:
+    FrameStream(size_t depth);
+
+    // make the slots cover the given frames (indices of the collection, in play order)
+    void update(const std::shared_ptr<ImageCollection>& collection, const std::vector<int>& indices);
+
+    // provider of a frame to display, shared with the slot if the frame is in the stream
+    std::shared_ptr<ImageProvider> getImageProvider(int index);
+
+    // next frame to load in play order, nullptr if they are all loaded
+    std::shared_ptr<ImageProvider> getNextToLoad();
+
+    // whether the frame is loaded in its slot
+    bool isLoaded(int index) const;
+
+    // files of the frames which are not loaded yet, in play order (only the frames which are whole files)
+    std::vector<std::string> getPendingFilenames() const;
+
+    // forget all frames, for instance because the files were modified
+    void flush();
+
+    Stats getStats() const;
+};
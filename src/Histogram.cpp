@@ -9,6 +9,8 @@
 #include "Colormap.hpp"
 #include "Histogram.hpp"
 #include "Image.hpp"
+#include "LoadingThread.hpp"
+#include "events.hpp"
 #include "globals.hpp"
 
 namespace imscript {
@@ -159,6 +161,10 @@ void Histogram::request(std::shared_ptr<Image> image, Mode mode, ImRect region)
     this->image = image;
     this->region = region;
     curh = 0;
+    requestClock = 0;
+    letTimeFlow(&requestClock);
+    latency = -1.;
+    duration = 0.;
 
     values.clear();
     values.resize(image->c);
@@ -168,6 +174,10 @@ void Histogram::request(std::shared_ptr<Image> image, Mode mode, ImRect region)
         histogram.clear();
         histogram.resize(nbins);
     }
+
+    if (gComputeThread) {
+        gComputeThread->notify();
+    }
 }
 
 float Histogram::getProgressPercentage() const
@@ -188,11 +198,22 @@ void Histogram::progress()
         std::lock_guard<std::recursive_mutex> _lock(lock);
         valuescopy = values;
         oldh = curh;
+        if (latency < 0.) {
+            uint64_t t = requestClock;
+            latency = letTimeFlow(&t);
+        }
     }
 
     std::shared_ptr<Image> image = this->image.lock();
-    if (!image)
+    if (!image) {
+        // the image is gone, nothing left to compute
+        // (otherwise the compute thread would spin on this histogram)
+        std::lock_guard<std::recursive_mutex> _lock(lock);
+        if (oldh == curh) {
+            loaded = true;
+        }
         return;
+    }
 
     if (mode == Mode::EXACT) {
         size_t minh = region.Min.y;
@@ -235,6 +256,8 @@ void Histogram::progress()
 
         if (curh == region.GetHeight()) {
             loaded = true;
+            uint64_t t = requestClock;
+            duration = letTimeFlow(&t);
         }
 
         values = valuescopy;
@@ -295,6 +318,12 @@ void Histogram::draw(const Colormap& colormap, const float* highlights)
             gSmoothHistogram = smooth;
             request(image.lock(), gSmoothHistogram ? Mode::SMOOTH : Mode::EXACT);
         }
+        if (isLoaded()) {
+            ImGui::Text("Computed in %.1fms (started after %.1fms)", duration, latency);
+        }
+        if (gComputeThread) {
+            ImGui::Text("Compute thread wakeups: %lu", gComputeThread->getWakeups());
+        }
         ImGui::EndPopup();
     }
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -29,6 +30,9 @@ public:
     size_t curh;
     const int nbins;
     ImRect region;
+    uint64_t requestClock;
+    double latency; // ms between request() and the first progress(), negative if not started
+    double duration; // ms between request() and the end of the computation
 
 public:
     Histogram()
@@ -37,6 +41,9 @@ public:
         , curh(0)
         , nbins(256)
         , region()
+        , requestClock(0)
+        , latency(-1.)
+        , duration(0.)
     {
     }
 
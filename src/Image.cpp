@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 #include <limits>
@@ -13,35 +14,77 @@ Image::Image(float* pixels, size_t w, size_t h, size_t c)
     , c(c)
     , lastUsed(0)
     , histogram(std::make_shared<Histogram>())
+    , validRows(h)
 {
-    static int id = 0;
-    id++;
+    // images can be created by several loading threads at once
+    static std::atomic<int> counter(0);
+    int id = ++counter;
     ID = "Image " + std::to_string(id);
 
-    min = std::numeric_limits<float>::max();
-    max = std::numeric_limits<float>::lowest();
+    computeRange();
+    size = ImVec2(w, h);
+}
+
+Image::Image(float* pixels, size_t w, size_t h, size_t c, float min, float max)
+    : Image(pixels, w, 0, c)
+{
+    this->h = h;
+    this->min = min;
+    this->max = max;
+    size = ImVec2(w, h);
+}
+
+void Image::computeRange()
+{
+    // computed aside, so that the UI never sees a partial range
+    float lo = std::numeric_limits<float>::max();
+    float hi = std::numeric_limits<float>::lowest();
     for (size_t i = 0; i < w * h * c; i++) {
         float v = pixels[i];
-        min = std::min(min, v);
-        max = std::max(max, v);
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
     }
-    if (!std::isfinite(min) || !std::isfinite(max)) {
-        min = std::numeric_limits<float>::max();
-        max = std::numeric_limits<float>::lowest();
+    if (!std::isfinite(lo) || !std::isfinite(hi)) {
+        lo = std::numeric_limits<float>::max();
+        hi = std::numeric_limits<float>::lowest();
         for (size_t i = 0; i < w * h * c; i++) {
             float v = pixels[i];
             if (std::isfinite(v)) {
-                min = std::min(min, v);
-                max = std::max(max, v);
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
             }
         }
     }
-    size = ImVec2(w, h);
+    min = lo;
+    max = hi;
+}
+
+void Image::setValidRows(size_t rows)
+{
+    validRows.store(std::min(rows, h), std::memory_order_release);
+}
+
+size_t Image::getValidRows() const
+{
+    return validRows.load(std::memory_order_acquire);
+}
+
+bool Image::isComplete() const
+{
+    return getValidRows() == h;
+}
+
+void Image::complete()
+{
+    computeRange();
+    setValidRows(h);
 }
 
 Image::~Image()
 {
-    free(pixels);
+    if (!owner) {
+        free(pixels);
+    }
 }
 
 void Image::getPixelValueAt(size_t x, size_t y, float* values, size_t d) const
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <set>
@@ -27,17 +28,34 @@ struct Image {
     std::string ID;
     float* pixels;
     size_t w, h, c;
+    // extent in the coordinates of the view, larger than (w, h) for reduced previews
     ImVec2 size;
-    float min;
-    float max;
+    // atomic since the UI reads the hints of a provisional image while complete() computes its range
+    std::atomic<float> min;
+    std::atomic<float> max;
     uint64_t lastUsed;
     std::shared_ptr<Histogram> histogram;
+    // when set, the pixels are borrowed from this object (e.g. a mapped file) instead of being freed with the image
+    std::shared_ptr<const void> owner;
 
     std::set<std::string> usedBy;
 
     Image(float* pixels, size_t w, size_t h, size_t c);
+    // provisional image, filled row by row by a decoder
+    // min and max are hints until complete() is called
+    Image(float* pixels, size_t w, size_t h, size_t c, float min, float max);
     ~Image();
 
+    void setValidRows(size_t rows);
+    size_t getValidRows() const;
+    bool isComplete() const;
+    void complete();
+
     void getPixelValueAt(size_t x, size_t y, float* values, size_t d) const;
     std::array<bool, 3> getPixelValueAtBands(size_t x, size_t y, BandIndices bands, float* values) const;
+
+private:
+    std::atomic<size_t> validRows;
+
+    void computeRange();
 };
@@ -124,6 +124,12 @@ bool isFull()
     return cacheFull;
 }
 
+size_t getSize()
+{
+    std::lock_guard<std::mutex> _lock(lock);
+    return cacheSize;
+}
+
 void flush()
 {
     std::lock_guard<std::mutex> _lock(lock);
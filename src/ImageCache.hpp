@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -19,6 +20,9 @@ bool remove_rec(const std::string& key);
 
 bool isFull();
 
+// memory used by the cached images, in bytes
+size_t getSize();
+
 void flush();
 
 namespace Error {
@@ -1,14 +1,51 @@
+#include <atomic>
+#include <cctype>
 #include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
 #include <system_error>
+#include <thread>
+#include <unordered_map>
 
+#include <doctest.h>
+#include <reproc++/reproc.hpp>
+
+#ifndef WINDOWS
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+#ifdef USE_IIO
+extern "C" {
+#include <iio.h>
+}
+#endif
+
+#include "Image.hpp"
 #include "ImageCollection.hpp"
 #include "ImageProvider.hpp"
+#include "MappedFile.hpp"
 #include "Player.hpp"
+#include "Readahead.hpp"
 #include "Sequence.hpp"
 #include "expected.hpp"
 #include "fs.hpp"
 #include "globals.hpp"
+#include "pixelconv.hpp"
 #include "strutils.hpp"
 #include "watcher.hpp"
 
@@ -34,6 +71,11 @@ static nonstd::expected<std::array<unsigned char, 4>, std::error_code> getFileTa
     return tag;
 }
 
+static bool isJPEGTag(const std::array<unsigned char, 4>& tag)
+{
+    return tag[0] == 0xff && tag[1] == 0xd8 && tag[2] == 0xff;
+}
+
 static std::shared_ptr<ImageProvider> selectProvider(const std::string& filename)
 {
     if (gForceIioOpen)
@@ -49,7 +91,7 @@ static std::shared_ptr<ImageProvider> selectProvider(const std::string& filename
         auto result = getFileTag(filename);
         if (result) {
             auto tag = *result;
-            if (tag[0] == 0xff && tag[1] == 0xd8 && tag[2] == 0xff) {
+            if (isJPEGTag(tag)) {
                 return std::make_shared<JPEGFileImageProvider>(filename);
             } else if (tag[1] == 'P' && tag[2] == 'N' && tag[3] == 'G') {
                 return std::make_shared<PNGFileImageProvider>(filename);
@@ -62,6 +104,10 @@ static std::shared_ptr<ImageProvider> selectProvider(const std::string& filename
                     return std::make_shared<TIFFFileImageProvider>(filename);
 #endif
                 }
+            } else if (tag[0] == 'P' && (tag[1] == 'F' || tag[1] == 'f') && isspace(tag[2])) {
+                return std::make_shared<PFMFileImageProvider>(filename);
+            } else if (tag[0] == 'P' && tag[1] == 'I' && tag[2] == 'E' && tag[3] == 'H') {
+                return std::make_shared<FLOFileImageProvider>(filename);
             }
         }
     }
@@ -86,11 +132,57 @@ iio2:
 #endif
 }
 
+// a frame can be requested several times while it is loading (e.g. displayed by a sequence and used by an edit),
+// in which case the loaders share the provider instead of decoding the file twice
+static std::shared_ptr<ImageProvider> getCacheImageProvider(const std::string& key,
+    const std::function<std::shared_ptr<ImageProvider>()>& get)
+{
+    static std::mutex lock;
+    static std::unordered_map<std::string, std::weak_ptr<ImageProvider>> loading;
+
+    {
+        std::lock_guard<std::mutex> _lock(lock);
+        auto it = loading.find(key);
+        if (it != loading.end()) {
+            std::shared_ptr<ImageProvider> provider = it->second.lock();
+            if (provider && !provider->isLoaded()) {
+                return provider;
+            }
+            loading.erase(it);
+        }
+    }
+
+    // not under the lock, edited collections request their inputs while constructing their provider
+    std::shared_ptr<ImageProvider> provider = std::make_shared<CacheImageProvider>(key, get);
+    if (provider->isLoaded()) {
+        return provider;
+    }
+
+    std::lock_guard<std::mutex> _lock(lock);
+    auto& entry = loading[key];
+    std::shared_ptr<ImageProvider> other = entry.lock();
+    if (other && !other->isLoaded()) {
+        return other;
+    }
+    entry = provider;
+    if (loading.size() > 1024) {
+        for (auto it = loading.begin(); it != loading.end();) {
+            if (it->second.expired()) {
+                it = loading.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    return provider;
+}
+
 std::shared_ptr<ImageProvider> SingleImageImageCollection::getImageProvider(int index) const
 {
     std::string key = getKey(index);
     std::string filename = this->filename;
     auto provider = [key, filename]() {
+        Readahead::onOpen(filename);
         std::shared_ptr<ImageProvider> provider = selectProvider(filename);
         watcher_add_file(filename, [key](const std::string& fname) {
             ImageCache::Error::remove(key);
@@ -99,7 +191,39 @@ std::shared_ptr<ImageProvider> SingleImageImageCollection::getImageProvider(int
         });
         return provider;
     };
-    return std::make_shared<CacheImageProvider>(key, provider);
+    return getCacheImageProvider(key, provider);
+}
+
+// previews are cached under their own key, so that they are never taken for the full resolution
+std::shared_ptr<ImageProvider> SingleImageImageCollection::getPreviewProvider(int index, int reduction) const
+{
+    // only JPEG can be decoded at a reduced resolution for a fraction of the cost
+    // the file is only checked once, this is called for each frame change while scrubbing
+    if (gForceIioOpen)
+        return nullptr;
+    if (jpeg < 0) {
+        bool isjpeg = false;
+        if (!fs::is_fifo(fs::path(filename))) {
+            auto tag = getFileTag(filename);
+            isjpeg = tag && isJPEGTag(*tag);
+        }
+        jpeg = isjpeg;
+    }
+    if (!jpeg)
+        return nullptr;
+
+    std::string key = getKey(index) + "@1/" + std::to_string(reduction);
+    std::string filename = this->filename;
+    auto provider = [key, filename, reduction]() {
+        std::shared_ptr<ImageProvider> provider = std::make_shared<JPEGFileImageProvider>(filename, reduction);
+        watcher_add_file(filename, [key](const std::string& fname) {
+            ImageCache::Error::remove(key);
+            ImageCache::remove(key);
+            gReloadImages = true;
+        });
+        return provider;
+    };
+    return getCacheImageProvider(key, provider);
 }
 
 std::shared_ptr<ImageProvider> EditedImageCollection::getImageProvider(int index) const
@@ -113,288 +237,2570 @@ std::shared_ptr<ImageProvider> EditedImageCollection::getImageProvider(int index
         }
         return std::make_shared<EditedImageProvider>(edittype, editprog, providers, key);
     };
-    return std::make_shared<CacheImageProvider>(key, provider);
+    return getCacheImageProvider(key, provider);
 }
 
-class VPPVideoImageProvider : public VideoImageProvider {
-    FILE* file;
+// Header and mapping of a .vpp file.
+// It is replaced (not modified) when the file grows or is reloaded, the providers keep the one they were created with.
+struct VPPFile {
+    std::shared_ptr<MappedFile> file;
     int w, h, d;
-    int curh;
-    float* pixels;
+    size_t length;
 
-public:
-    VPPVideoImageProvider(const std::string& filename, int index, int w, int h, int d)
-        : VideoImageProvider(filename, index)
-        , file(fopen(filename.c_str(), "r"))
-        , w(w)
-        , h(h)
-        , d(d)
-        , curh(0)
+    static const size_t headerSize = 4 + 3 * sizeof(int);
+
+    size_t getFrameSize() const
     {
-        fseek(file, 4 + 3 * sizeof(int) + w * h * d * sizeof(float) * index, SEEK_SET);
-        pixels = (float*)malloc(w * h * d * sizeof(float));
+        return (size_t)w * h * d * sizeof(float);
     }
 
-    ~VPPVideoImageProvider() override
+    size_t getFrameOffset(int index) const
+    {
+        return headerSize + index * getFrameSize();
+    }
+};
+
+static std::shared_ptr<const VPPFile> loadVPPFile(const std::string& filename)
+{
+    std::shared_ptr<MappedFile> file = MappedFile::open(filename);
+    if (!file || file->getSize() < VPPFile::headerSize) {
+        fprintf(stderr, "[vpp] cannot read the header of '%s'\n", filename.c_str());
+        return nullptr;
+    }
+    auto vpp = std::make_shared<VPPFile>();
+    const uint8_t* data = file->getData();
+    memcpy(&vpp->w, data + 4, sizeof(int));
+    memcpy(&vpp->h, data + 4 + sizeof(int), sizeof(int));
+    memcpy(&vpp->d, data + 4 + 2 * sizeof(int), sizeof(int));
+    if (vpp->w <= 0 || vpp->h <= 0 || vpp->d <= 0) {
+        fprintf(stderr, "[vpp] invalid size %dx%dx%d in '%s'\n", vpp->w, vpp->h, vpp->d, filename.c_str());
+        return nullptr;
+    }
+    vpp->file = file;
+    // a file which is still being written only exposes its complete frames
+    vpp->length = (file->getSize() - VPPFile::headerSize) / vpp->getFrameSize();
+    return vpp;
+}
+
+class VPPVideoImageProvider : public VideoImageProvider {
+    std::shared_ptr<const VPPFile> vpp;
+
+public:
+    VPPVideoImageProvider(const std::string& filename, int index, const std::shared_ptr<const VPPFile>& vpp)
+        : VideoImageProvider(filename, index)
+        , vpp(vpp)
     {
-        if (pixels)
-            free(pixels);
-        fclose(file);
     }
 
+    ~VPPVideoImageProvider() override = default;
+
     float getProgressPercentage() const override
     {
-        return (float)curh / h;
+        return 0.f;
     }
 
+    // the frame is served at once, without conversion
+    // the writer can truncate the file (e.g. when it starts again), hence the copy (see MappedFile::read)
     void progress() override
     {
-        if (curh < h) {
-            if (!fread(pixels + curh * w * d, sizeof(float), w * d, file)) {
-                onFinish(makeError("error vpp"));
-            }
-            curh++;
-        } else {
-            auto image = std::make_shared<Image>(pixels, w, h, d);
-            onFinish(image);
-            pixels = nullptr;
+        if (!vpp || frame >= (int)vpp->length) {
+            onFinish(makeError("error vpp"));
+            return;
+        }
+        const VPPFile& v = *vpp;
+        float* pixels = (float*)malloc(v.getFrameSize());
+        if (!v.file->read(v.getFrameOffset(frame), v.getFrameSize(), pixels)) {
+            free(pixels);
+            onFinish(makeError("vpp: couldn't read frame " + std::to_string(frame)));
+            return;
         }
+        onFinish(std::make_shared<Image>(pixels, v.w, v.h, v.d));
     }
 };
 
+// called by the main thread when collections grew (or changed) behind the players' back
+// with 'follow', the players which were showing their last frame move to the newest one
+static void onLengthChange(bool follow = gTailJump)
+{
+    std::vector<bool> atEnd;
+    for (const auto& p : gPlayers) {
+        atEnd.push_back(p->frame == p->maxFrame);
+    }
+    for (const auto& p : gPlayers) {
+        p->reconfigureBounds();
+    }
+    for (size_t i = 0; follow && i < gPlayers.size(); i++) {
+        if (atEnd[i]) {
+            gPlayers[i]->frame = gPlayers[i]->maxFrame;
+        }
+    }
+    gActive = std::max(gActive, 2);
+}
+
+// forgets the cached frames [0, length) of a video whose file was modified, and reloads the displayed ones
+static void forgetVideoFrames(const std::string& filename, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        std::string key = VideoImageCollection::makeKey(filename, i);
+        ImageCache::Error::remove(key);
+        ImageCache::remove(key);
+    }
+    gReloadImages = true;
+}
+
+// VPP files are typically written frame by frame by a running program:
+// the collection follows the growth of the file (see TAIL in the help)
 class VPPVideoImageCollection : public VideoImageCollection {
-    size_t length;
-    int w, h, d;
+    struct State {
+        std::mutex mutex;
+        std::shared_ptr<const VPPFile> vpp;
+        bool watched;
+    };
+    // shared with the watcher callback and the tail poll, which can outlive the collection
+    std::shared_ptr<State> state;
+
+    // collections whose file size is polled
+    static std::mutex tailedLock;
+    static std::vector<std::pair<std::string, std::weak_ptr<State>>> tailed;
+
+    // remaps the file if its size changed (or if it was modified, when 'modified' is set)
+    // returns whether the players have to be reconfigured
+    static bool refresh(const std::string& filename, State& state, bool modified);
 
 public:
     VPPVideoImageCollection(const std::string& filename)
         : VideoImageCollection(filename)
-        , length(0)
+        , state(std::make_shared<State>())
     {
-        FILE* file = fopen(filename.c_str(), "r");
-        std::array<char, 4> tag;
-        if (fread(tag.data(), 1, 4, file) == 4
-            && fread(&w, sizeof(int), 1, file)
-            && fread(&h, sizeof(int), 1, file)
-            && fread(&d, sizeof(int), 1, file)) {
-            fseek(file, 0, SEEK_END);
-            length = (ftell(file) - 4 - 3 * sizeof(int)) / (w * h * d * sizeof(float));
-        }
-        fclose(file);
+        state->vpp = loadVPPFile(filename);
+        state->watched = false;
+        std::lock_guard<std::mutex> _lock(tailedLock);
+        tailed.emplace_back(filename, state);
     }
 
     ~VPPVideoImageCollection() override = default;
 
     int getLength() const override
     {
-        return length;
+        std::lock_guard<std::mutex> _lock(state->mutex);
+        return state->vpp ? state->vpp->length : 0;
     }
 
     std::shared_ptr<ImageProvider> getImageProvider(int index) const override
     {
-        auto provider = [&]() {
-            return std::make_shared<VPPVideoImageProvider>(filename, index, w, h, d);
-        };
         std::string key = getKey(index);
-        return std::make_shared<CacheImageProvider>(key, provider);
+        std::string filename = this->filename;
+        std::shared_ptr<State> state = this->state;
+        auto provider = [key, filename, state, index]() {
+            std::lock_guard<std::mutex> _lock(state->mutex);
+            if (!state->watched) {
+                state->watched = true;
+                watcher_add_file(filename, [filename, state](const std::string& fname) {
+                    if (refresh(filename, *state, true)) {
+                        onLengthChange();
+                    }
+                });
+            }
+            return std::make_shared<VPPVideoImageProvider>(filename, index, state->vpp);
+        };
+        return getCacheImageProvider(key, provider);
     }
+
+    static void pollTailed();
 };
 
-#ifdef USE_IIO_NPY
-extern "C" {
-#include <npy.h>
-}
+std::mutex VPPVideoImageCollection::tailedLock;
+std::vector<std::pair<std::string, std::weak_ptr<VPPVideoImageCollection::State>>> VPPVideoImageCollection::tailed;
 
-class NumpyVideoImageProvider : public VideoImageProvider {
-    int w, h, d;
-    size_t length;
-    struct npy_info ni;
+bool VPPVideoImageCollection::refresh(const std::string& filename, State& state, bool modified)
+{
+    std::error_code ec;
+    uintmax_t size = fs::file_size(fs::path(filename), ec);
+    if (ec) {
+        return false;
+    }
 
-public:
-    NumpyVideoImageProvider(const std::string& filename, int index, int w, int h,
-        int d, size_t length, struct npy_info ni)
-        : VideoImageProvider(filename, index)
-        , w(w)
-        , h(h)
-        , d(d)
-        , length(length)
-        , ni(ni)
+    std::lock_guard<std::mutex> _lock(state.mutex);
+    std::shared_ptr<const VPPFile> old = state.vpp;
+    size_t oldSize = old ? old->file->getSize() : 0;
+    if (size == oldSize && !modified) {
+        return false;
+    }
+    std::shared_ptr<const VPPFile> vpp = loadVPPFile(filename);
+    size_t oldLength = old ? old->length : 0;
+    // frames are only ever appended by the writer, unless the file shrinks or its header changes
+    bool appended = old && vpp && size > oldSize
+        && vpp->w == old->w && vpp->h == old->h && vpp->d == old->d;
+    if (!appended) {
+        forgetVideoFrames(filename, oldLength);
+    }
+    // the providers which are still loading keep the previous mapping
+    state.vpp = vpp;
+    return !appended || vpp->length != oldLength;
+}
+
+void VPPVideoImageCollection::pollTailed()
+{
+    std::vector<std::pair<std::string, std::shared_ptr<State>>> states;
     {
+        std::lock_guard<std::mutex> _lock(tailedLock);
+        for (auto it = tailed.begin(); it != tailed.end();) {
+            if (std::shared_ptr<State> state = it->second.lock()) {
+                states.emplace_back(it->first, state);
+                ++it;
+            } else {
+                it = tailed.erase(it);
+            }
+        }
     }
 
-    ~NumpyVideoImageProvider() override = default;
+    bool changed = false;
+    for (const auto& s : states) {
+        changed |= refresh(s.first, *s.second, false);
+    }
+    if (changed) {
+        onLengthChange();
+    }
+}
 
-    float getProgressPercentage() const override
+// Layout of a YUV4MPEG2 (.y4m) file and the offsets of its frames.
+// The frame headers can carry parameters, so the frames are not at regular offsets:
+// they are found by a scan of the file, whose result is saved next to large files (see loadY4MFile).
+struct Y4MFile {
+    std::shared_ptr<MappedFile> file;
+    int w, h;
+    // size of the chroma planes (0 for grayscale)
+    int cw, ch;
+    int depth;
+    bool fullRange;
+    // size of the planes of a frame, including the alpha plane if any
+    size_t frameSize;
+    // position of the first sample of each frame
+    std::vector<uint64_t> offsets;
+
+    size_t getSampleSize() const
     {
-        return 1.f;
+        return depth > 8 ? 2 : 1;
     }
+};
 
-    void progress() override
+// parses the stream header, returns its length (0 if it is not valid)
+static size_t parseY4MHeader(const uint8_t* data, size_t size, Y4MFile* y4m)
+{
+    const char magic[] = "YUV4MPEG2 ";
+    const uint8_t* end = static_cast<const uint8_t*>(memchr(data, '\n', std::min<size_t>(size, 1024)));
+    if (!end || size < sizeof(magic) - 1 || memcmp(data, magic, sizeof(magic) - 1)) {
+        return 0;
+    }
+
+    std::string colorspace = "420jpeg";
+    y4m->w = y4m->h = 0;
+    y4m->fullRange = false;
+    std::istringstream header(std::string(reinterpret_cast<const char*>(data) + sizeof(magic) - 1,
+        reinterpret_cast<const char*>(end)));
+    std::string token;
+    while (header >> token) {
+        if (token[0] == 'W') {
+            y4m->w = atoi(token.c_str() + 1);
+        } else if (token[0] == 'H') {
+            y4m->h = atoi(token.c_str() + 1);
+        } else if (token[0] == 'C') {
+            colorspace = token.substr(1);
+        } else if (token == "XCOLORRANGE=FULL") {
+            y4m->fullRange = true;
+        }
+    }
+    if (y4m->w <= 0 || y4m->h <= 0) {
+        return 0;
+    }
+
+    // 420jpeg, 420paldv, 420mpeg2, 420p10, 422, 444p12, 444alpha, mono, mono16...
+    int planes = 3;
+    y4m->depth = 8;
+    size_t p = colorspace.find('p');
+    if (p != std::string::npos && p + 1 < colorspace.size() && isdigit(colorspace[p + 1])) {
+        y4m->depth = atoi(colorspace.c_str() + p + 1);
+    }
+    if (startswith(colorspace, "420")) {
+        y4m->cw = (y4m->w + 1) / 2;
+        y4m->ch = (y4m->h + 1) / 2;
+    } else if (startswith(colorspace, "422")) {
+        y4m->cw = (y4m->w + 1) / 2;
+        y4m->ch = y4m->h;
+    } else if (startswith(colorspace, "444")) {
+        y4m->cw = y4m->w;
+        y4m->ch = y4m->h;
+        if (colorspace == "444alpha")
+            planes = 4;
+    } else if (startswith(colorspace, "mono")) {
+        y4m->cw = y4m->ch = 0;
+        planes = 1;
+        if (colorspace.size() > 4)
+            y4m->depth = atoi(colorspace.c_str() + 4);
+    } else {
+        fprintf(stderr, "[y4m] unsupported colorspace '%s'\n", colorspace.c_str());
+        return 0;
+    }
+    if (y4m->depth < 8 || y4m->depth > 16) {
+        fprintf(stderr, "[y4m] unsupported depth %d\n", y4m->depth);
+        return 0;
+    }
+
+    size_t luma = (size_t)y4m->w * y4m->h;
+    size_t chroma = (size_t)y4m->cw * y4m->ch;
+    y4m->frameSize = (luma + (planes > 1 ? 2 * chroma : 0) + (planes > 3 ? luma : 0)) * y4m->getSampleSize();
+    return end + 1 - data;
+}
+
+// offsets of the complete frames, starting at 'pos'
+static std::vector<uint64_t> scanY4MFrames(const MappedFile& file, size_t pos, size_t frameSize)
+{
+    std::vector<uint64_t> offsets;
+    const uint8_t* data = file.getData();
+    size_t size = file.getSize();
+    while (pos + 5 < size && !memcmp(data + pos, "FRAME", 5)) {
+        // the frame header is short, but may have parameters
+        const void* nl = memchr(data + pos + 5, '\n', std::min<size_t>(size - pos - 5, 1024));
+        if (!nl)
+            break;
+        size_t start = static_cast<const uint8_t*>(nl) + 1 - data;
+        if (start + frameSize > size)
+            break;
+        offsets.push_back(start);
+        pos = start + frameSize;
+    }
+    return offsets;
+}
+
+// the index of files larger than this is saved in a sidecar file (<file>.vpvidx), since the scan
+// touches one page per frame: slow on a disk for hundreds of thousands of frames
+static const size_t y4mIndexThreshold = (size_t)1 << 30;
+
+// identifies the version of the video which was indexed
+static int64_t getModificationTime(const std::string& filename)
+{
+    std::error_code ec;
+    auto time = fs::last_write_time(fs::path(filename), ec);
+    return ec ? 0 : (int64_t)time.time_since_epoch().count();
+}
+
+static bool readY4MIndex(const std::string& filename, const Y4MFile& y4m, std::vector<uint64_t>* offsets)
+{
+    std::shared_ptr<MappedFile> index = MappedFile::open(filename + ".vpvidx");
+    if (!index || index->getSize() < 32 || memcmp(index->getData(), "VPVY4MI1", 8))
+        return false;
+    uint64_t size, count;
+    int64_t mtime;
+    memcpy(&size, index->getData() + 8, 8);
+    memcpy(&mtime, index->getData() + 16, 8);
+    memcpy(&count, index->getData() + 24, 8);
+    // the count is checked against the size of the index first, so that a corrupt one can't overflow
+    if (size != y4m.file->getSize() || mtime != getModificationTime(filename)
+        || count > (index->getSize() - 32) / 8 || index->getSize() != 32 + count * 8)
+        return false;
+    offsets->resize(count);
+    memcpy(offsets->data(), index->getData() + 32, count * 8);
+    for (size_t i = 0; i < count; i++) {
+        uint64_t end = i + 1 < count ? (*offsets)[i + 1] : size;
+        if ((*offsets)[i] > end || end - (*offsets)[i] < y4m.frameSize)
+            return false;
+    }
+    return true;
+}
+
+static void writeY4MIndex(const std::string& filename, const Y4MFile& y4m)
+{
+    // best effort, the directory can be read-only
+    FILE* f = fopen((filename + ".vpvidx").c_str(), "wb");
+    if (!f)
+        return;
+    uint64_t size = y4m.file->getSize();
+    int64_t mtime = getModificationTime(filename);
+    uint64_t count = y4m.offsets.size();
+    bool ok = fwrite("VPVY4MI1", 1, 8, f) == 8 && fwrite(&size, 8, 1, f) == 1 && fwrite(&mtime, 8, 1, f) == 1
+        && fwrite(&count, 8, 1, f) == 1 && fwrite(y4m.offsets.data(), 8, count, f) == count;
+    if (fclose(f) || !ok) {
+        remove((filename + ".vpvidx").c_str());
+    }
+}
+
+static std::shared_ptr<const Y4MFile> loadY4MFile(const std::string& filename)
+{
+    auto y4m = std::make_shared<Y4MFile>();
+    y4m->file = MappedFile::open(filename);
+    if (!y4m->file) {
+        fprintf(stderr, "[y4m] file '%s' does not exist\n", filename.c_str());
+        return nullptr;
+    }
+    const MappedFile& file = *y4m->file;
+    size_t headerSize = parseY4MHeader(file.getData(), file.getSize(), y4m.get());
+    if (!headerSize) {
+        fprintf(stderr, "[y4m] invalid header in '%s'\n", filename.c_str());
+        return nullptr;
+    }
+
+    bool large = file.getSize() >= y4mIndexThreshold;
+    if (!large || !readY4MIndex(filename, *y4m, &y4m->offsets)) {
+        y4m->offsets = scanY4MFrames(file, headerSize, y4m->frameSize);
+        if (large) {
+            writeY4MIndex(filename, *y4m);
+        }
+    }
+    printf("opened y4m video '%s': %dx%d, %lu frames, %d bits\n", filename.c_str(), y4m->w, y4m->h,
+        y4m->offsets.size(), y4m->depth);
+    return y4m;
+}
+
+class Y4MVideoImageProvider : public VideoImageProvider {
+    std::shared_ptr<const Y4MFile> y4m;
+    std::shared_ptr<Image> image;
+    int curh;
+    // planes of the frame, read from the file (see MappedFile::read)
+    std::vector<uint8_t> samples;
+    // rows of samples, converted to float
+    std::vector<float> luma, cb, cr;
+    int chromaRow;
+
+    void convertRow(const uint8_t* src, float* dst, size_t n)
     {
-        FILE* file = fopen(filename.c_str(), "r");
-        // compute frame position and read it
-        size_t framesize = npy_type_size(ni.type) * w * h * d;
-        long pos = ni.header_offset + frame * framesize;
-        fseek(file, pos, SEEK_SET);
-        void* data = malloc(framesize);
-        if (fread(data, 1, framesize, file) != framesize) {
-            onFinish(makeError("npy: couldn't read frame"));
+        if (y4m->depth > 8) {
+            convertU16LEToFloat(src, dst, n);
         } else {
-            // convert to float
-            float* pixels = npy_convert_to_float(data, w * h * d, ni.type);
-            auto image = std::make_shared<Image>(pixels, w, h, d);
-            onFinish(image);
+            convertU8ToFloat(src, dst, n);
         }
-        fclose(file);
     }
-};
-
-class NumpyVideoImageCollection : public VideoImageCollection {
-    size_t length;
-    int w, h, d;
-    struct npy_info ni;
 
-    void loadHeader()
+    void convertRow(int y)
     {
-        FILE* file = fopen(filename.c_str(), "r");
-        if (!file) {
-            fprintf(stderr, "[npy] file '%s' does not exist\n", filename.c_str());
+        const Y4MFile& v = *y4m;
+        const uint8_t* frame = samples.data();
+        size_t sample = v.getSampleSize();
+        float* dst = image->pixels + (size_t)y * v.w * image->c;
+        if (!v.cw) {
+            convertRow(frame + (size_t)y * v.w * sample, dst, v.w);
             return;
         }
-        if (!npy_read_header(file, &ni)) {
-            fprintf(stderr, "[npy] error while loading header\n");
-            //exit(1);
+
+        convertRow(frame + (size_t)y * v.w * sample, luma.data(), v.w);
+        // with 4:2:0, two consecutive rows share their chroma
+        int cy = v.ch < v.h ? y / 2 : y;
+        if (cy != chromaRow) {
+            const uint8_t* planes = frame + (size_t)v.w * v.h * sample;
+            size_t planeSize = (size_t)v.cw * v.ch * sample;
+            convertRow(planes + (size_t)cy * v.cw * sample, cb.data(), v.cw);
+            convertRow(planes + planeSize + (size_t)cy * v.cw * sample, cr.data(), v.cw);
+            chromaRow = cy;
         }
-        fclose(file);
 
-        if (ni.fortran_order) {
-            fprintf(stderr, "numpy array '%s' is fortran order, please ask kidanger for support.\n",
-                filename.c_str());
-            exit(1);
+        bool subsampled = v.cw < v.w;
+        if (gY4MConvertToRGB) {
+            convertYCbCrToRGB(luma.data(), cb.data(), cr.data(), subsampled, v.depth, v.fullRange, dst, v.w);
+        } else {
+            for (int x = 0; x < v.w; x++) {
+                int cx = subsampled ? x / 2 : x;
+                dst[x * 3 + 0] = luma[x];
+                dst[x * 3 + 1] = cb[cx];
+                dst[x * 3 + 2] = cr[cx];
+            }
         }
+    }
 
-        d = 1;
-        length = 1;
-        if (ni.ndims == 2) {
-            h = ni.dims[0];
-            w = ni.dims[1];
-        } else if (ni.ndims == 3) {
-            if (ni.dims[2] < ni.dims[0] && ni.dims[2] < ni.dims[1]) {
-                h = ni.dims[0];
-                w = ni.dims[1];
-                d = ni.dims[2];
-            } else {
-                length = ni.dims[0];
-                h = ni.dims[1];
-                w = ni.dims[2];
+public:
+    Y4MVideoImageProvider(const std::string& filename, int index, const std::shared_ptr<const Y4MFile>& y4m)
+        : VideoImageProvider(filename, index)
+        , y4m(y4m)
+        , curh(0)
+        , chromaRow(-1)
+    {
+    }
+
+    ~Y4MVideoImageProvider() override = default;
+
+    float getProgressPercentage() const override
+    {
+        return image ? (float)curh / image->h : 0.f;
+    }
+
+    void progress() override
+    {
+        if (!image) {
+            if (!y4m || frame >= (int)y4m->offsets.size()) {
+                onFinish(makeError("y4m: couldn't read frame"));
+                return;
             }
-        } else if (ni.ndims == 4) {
-            length = ni.dims[0];
-            h = ni.dims[1];
-            w = ni.dims[2];
-            d = ni.dims[3];
+            const Y4MFile& v = *y4m;
+            // the alpha plane is not shown
+            samples.resize(((size_t)v.w * v.h + 2 * (size_t)v.cw * v.ch) * v.getSampleSize());
+            if (!v.file->read(v.offsets[frame], samples.size(), samples.data())) {
+                onFinish(makeError("y4m: couldn't read frame"));
+                return;
+            }
+            // the next frame is read from the disk while this one is converted, for the playback
+            if (frame + 1 < (int)v.offsets.size()) {
+                v.file->willNeed(v.offsets[frame + 1], v.frameSize);
+            }
+            int channels = v.cw ? 3 : 1;
+            luma.resize(v.w);
+            cb.resize(v.cw);
+            cr.resize(v.cw);
+            float* pixels = (float*)malloc(sizeof(float) * v.w * v.h * channels);
+            image = std::make_shared<Image>(pixels, v.w, v.h, channels, 0.f, (float)((1 << v.depth) - 1));
+            setProvisionalImage(image);
         }
 
-        printf("opened numpy array '%s', assuming size: (n=%lu, h=%d, w=%d, d=%d), type=%s\n",
-            filename.c_str(), length, h, w, d, ni.desc);
+        if (curh < (int)image->h) {
+            ProgressBudget budget;
+            do {
+                convertRow(curh);
+                curh++;
+            } while (curh < (int)image->h && !budget.exhausted());
+            image->setValidRows(curh);
+        } else {
+            image->complete();
+            onFinish(image);
+            image = nullptr;
+            samples = std::vector<uint8_t>();
+        }
     }
+};
+
+class Y4MVideoImageCollection : public VideoImageCollection {
+    struct State {
+        std::mutex mutex;
+        std::shared_ptr<const Y4MFile> y4m;
+        bool watched;
+    };
+    // shared with the watcher callback, which can outlive the collection
+    std::shared_ptr<State> state;
 
 public:
-    NumpyVideoImageCollection(const std::string& filename)
+    Y4MVideoImageCollection(const std::string& filename)
         : VideoImageCollection(filename)
-        , length(0)
+        , state(std::make_shared<State>())
     {
-        loadHeader();
+        state->y4m = loadY4MFile(filename);
+        state->watched = false;
     }
 
-    ~NumpyVideoImageCollection() override = default;
+    ~Y4MVideoImageCollection() override = default;
 
     int getLength() const override
     {
-        return length;
+        std::lock_guard<std::mutex> _lock(state->mutex);
+        return state->y4m ? state->y4m->offsets.size() : 0;
     }
 
     std::shared_ptr<ImageProvider> getImageProvider(int index) const override
     {
         std::string key = getKey(index);
         std::string filename = this->filename;
-        auto provider = [&]() {
-            auto provider = std::make_shared<NumpyVideoImageProvider>(filename, index, w, h, d, length, ni);
-            watcher_add_file(filename, [key, this](const std::string& fname) {
-                ImageCache::Error::remove(key);
-                ImageCache::remove(key);
-                gReloadImages = true;
-                // that's ugly
-                ((NumpyVideoImageCollection*)this)->loadHeader();
-                // reconfigure players in case the length changed
-                for (const auto& p : gPlayers) {
-                    p->reconfigureBounds();
-                }
-            });
-            return provider;
+        std::shared_ptr<State> state = this->state;
+        auto provider = [key, filename, state, index]() {
+            std::lock_guard<std::mutex> _lock(state->mutex);
+            if (!state->watched) {
+                state->watched = true;
+                watcher_add_file(filename, [filename, state](const std::string& fname) {
+                    {
+                        std::lock_guard<std::mutex> _lock(state->mutex);
+                        forgetVideoFrames(filename, state->y4m ? state->y4m->offsets.size() : 0);
+                        state->y4m = loadY4MFile(filename);
+                    }
+                    onLengthChange();
+                });
+            }
+            return std::make_shared<Y4MVideoImageProvider>(filename, index, state->y4m);
         };
-        return std::make_shared<CacheImageProvider>(key, provider);
+        return getCacheImageProvider(key, provider);
     }
 };
-#endif
 
-static std::shared_ptr<ImageCollection> selectCollection(const fs::path& path)
+#ifndef USE_GDAL
+#include <tiffio.h>
+
+// offsets of the pages of a TIFF file, without the reduced-resolution versions (overviews, thumbnails)
+// the first directory is recorded as 0, so that its provider can fall back to iio
+static std::vector<uint64_t> indexTIFFPages(const std::string& filename)
 {
-    if (fs::is_regular_file(path)) {
-        auto result = getFileTag(path);
-        if (result) {
-            auto tag = *result;
-            if (tag[0] == 'V' && tag[1] == 'P' && tag[2] == 'P' && tag[3] == 0) {
-                return std::make_shared<VPPVideoImageCollection>(path.u8string());
-            }
-#ifdef USE_IIO_NPY
-            if (tag[0] == 0x93 && tag[1] == 'N' && tag[2] == 'U' && tag[3] == 'M') {
-                return std::make_shared<NumpyVideoImageCollection>(path.u8string());
-            }
-#endif
+    std::vector<uint64_t> offsets;
+    TIFF* tif = TIFFOpen(filename.c_str(), "rm");
+    if (!tif)
+        return offsets;
+    bool first = true;
+    do {
+        uint32_t subfiletype = 0;
+        if (!TIFFGetField(tif, TIFFTAG_SUBFILETYPE, &subfiletype) || !(subfiletype & FILETYPE_REDUCEDIMAGE)) {
+            offsets.push_back(first ? 0 : TIFFCurrentDirOffset(tif));
         }
-    }
-
-    return std::make_shared<SingleImageImageCollection>(path.u8string());
+        first = false;
+    } while (TIFFReadDirectory(tif));
+    TIFFClose(tif);
+    return offsets;
 }
 
-#ifdef USE_GDAL
-std::vector<fs::path> unpack_gdal_subdatasets(const std::string& filename)
-{
-    auto unpacked = std::vector<fs::path> {};
+// frame which is not (or no longer) in its file, e.g. after the file was rewritten with fewer pages
+class MissingFrameImageProvider : public VideoImageProvider {
+    std::string error;
 
-    GDALDataset* g = (GDALDataset*)GDALOpen(filename.c_str(), GA_ReadOnly);
-    if (g == nullptr) {
-        return unpacked;
+public:
+    MissingFrameImageProvider(const std::string& filename, int index, const std::string& error)
+        : VideoImageProvider(filename, index)
+        , error(error)
+    {
     }
 
-    // example of SUBDATASETS:
-    // SUBDATASET_1_NAME=GTIFF_DIR:1:/tmp/t/multipage_tiff_example.tif
-    // SUBDATASET_1_DESC=Page 1 (800P x 600L x 3B)
-    // SUBDATASET_2_NAME=GTIFF_DIR:2:/tmp/t/multipage_tiff_example.tif
-    // SUBDATASET_2_DESC=Page 2 (800P x 600L x 3B)
-    char** subdatasets = g->GetMetadata("SUBDATASETS");
+    ~MissingFrameImageProvider() override = default;
 
-    if (subdatasets != nullptr && *subdatasets != nullptr) {
-        for (int i = 0; subdatasets[i] != nullptr; i++) {
-            std::string metadata(subdatasets[i]);
-            if (metadata.find("_NAME=") != std::string::npos) {
-                size_t pos = metadata.find("=");
-                if (pos != std::string::npos) {
-                    std::string path = metadata.substr(pos + 1);
-                    unpacked.push_back(fs::path(path));
-                }
-            }
-        }
+    float getProgressPercentage() const override
+    {
+        return 0.f;
     }
 
-    if (g != nullptr) {
-        GDALClose(g);
+    void progress() override
+    {
+        onFinish(makeError(error));
     }
+};
 
-    return unpacked;
-}
-#endif // USE_GDAL
+// Multi-page TIFF (microscopy stacks, bursts), one frame per page.
+// The pages are indexed once, so that each provider opens its page directly
+// instead of walking the chain of directories.
+class TIFFVideoImageCollection : public VideoImageCollection {
+    struct Pages {
+        std::mutex mutex;
+        std::vector<uint64_t> offsets;
+        bool watched;
+    };
+    // shared with the watcher callback, which can outlive the collection
+    std::shared_ptr<Pages> pages;
+
+public:
+    TIFFVideoImageCollection(const std::string& filename, const std::vector<uint64_t>& offsets)
+        : VideoImageCollection(filename)
+        , pages(std::make_shared<Pages>())
+    {
+        pages->offsets = offsets;
+        pages->watched = false;
+    }
+
+    ~TIFFVideoImageCollection() override = default;
+
+    int getLength() const override
+    {
+        std::lock_guard<std::mutex> _lock(pages->mutex);
+        return pages->offsets.size();
+    }
+
+    std::shared_ptr<ImageProvider> getImageProvider(int index) const override
+    {
+        std::string key = getKey(index);
+        std::string filename = this->filename;
+        std::shared_ptr<Pages> pages = this->pages;
+        auto provider = [key, filename, pages, index]() {
+            std::lock_guard<std::mutex> _lock(pages->mutex);
+            if (!pages->watched) {
+                pages->watched = true;
+                watcher_add_file(filename, [filename, pages](const std::string& fname) {
+                    // indexed here rather than in getLength, which is called by the UI
+                    std::vector<uint64_t> offsets = indexTIFFPages(filename);
+                    {
+                        std::lock_guard<std::mutex> _lock(pages->mutex);
+                        // including the pages which were missing before (their error is cached)
+                        forgetVideoFrames(filename, std::max(pages->offsets.size(), offsets.size()));
+                        pages->offsets = std::move(offsets);
+                    }
+                    onLengthChange();
+                });
+            }
+            if (index < 0 || index >= (int)pages->offsets.size()) {
+                return std::shared_ptr<ImageProvider>(std::make_shared<MissingFrameImageProvider>(
+                    filename, index, "tiff: no page " + std::to_string(index + 1)));
+            }
+            return std::shared_ptr<ImageProvider>(
+                std::make_shared<TIFFFileImageProvider>(filename, pages->offsets[index]));
+        };
+        return getCacheImageProvider(key, provider);
+    }
+};
+#endif
+
+// Layout of an array of samples (.npy array, raw dump) and the mapping of its file.
+// It is replaced (not modified) when the file is reloaded, the providers keep the one they were created with.
+struct NumpyArray {
+    std::shared_ptr<MappedFile> file;
+    SampleType type;
+    bool bigEndian;
+    size_t length;
+    int w, h, d;
+    // position of the first sample in the file, in bytes
+    size_t offset;
+    // distance between two frames, rows, columns and channels, in samples
+    size_t strides[4];
+
+    size_t getSampleSize() const
+    {
+        return ::getSampleSize(type);
+    }
+
+    const uint8_t* getFrame(int index) const
+    {
+        return file->getData() + offset + index * strides[0] * getSampleSize();
+    }
+
+    // whether the samples of a frame are stored in the order of the pixels of an image
+    // (the stride of a dimension of size 1 does not matter)
+    bool isFrameContiguous() const
+    {
+        return (d == 1 || strides[3] == 1) && (w == 1 || strides[2] == (size_t)d)
+            && (h == 1 || strides[1] == (size_t)w * d);
+    }
+};
+
+class NumpyVideoImageProvider : public VideoImageProvider {
+    std::shared_ptr<const NumpyArray> array;
+    std::shared_ptr<Image> image;
+    // samples of the frame (from the first one to the last one) when they are read from a file,
+    // see MappedFile::read
+    std::vector<uint8_t> samples;
+    // the samples of the frame are scattered over the file (fortran order, the frames are interleaved):
+    // they are converted from the mapping, a band of rows at a time, once the file still holds the band
+    bool scattered;
+    int curh;
+
+    // whether the file still holds the samples of rows [y, y+rows), see MappedFile::holds
+    bool holdsRows(int y, int rows) const
+    {
+        const NumpyArray& a = *array;
+        size_t first = y * a.strides[1];
+        size_t last = (y + rows - 1) * a.strides[1] + (a.w - 1) * a.strides[2] + (a.d - 1) * a.strides[3];
+        size_t offset = a.getFrame(frame) - a.file->getData();
+        return a.file->holds(offset + first * a.getSampleSize(), (last - first + 1) * a.getSampleSize());
+    }
+
+    // converts rows [y, y+rows) of the frame
+    void convertRows(int y, int rows)
+    {
+        const NumpyArray& a = *array;
+        const uint8_t* src = samples.empty() ? a.getFrame(frame) : samples.data();
+        size_t size = a.getSampleSize();
+        size_t rowlength = (size_t)a.w * a.d;
+        if (a.isFrameContiguous()) {
+            convertSamplesToFloat(a.type, a.bigEndian, src + y * rowlength * size, 1,
+                image->pixels + y * rowlength, 1, rows * rowlength);
+            return;
+        }
+        if (a.strides[2] == 1) {
+            // planar frame: the rows of each channel are contiguous, they are interleaved in the image
+            for (int r = y; r < y + rows; r++) {
+                for (int c = 0; c < a.d; c++) {
+                    convertSamplesToFloat(a.type, a.bigEndian, src + (r * a.strides[1] + c * a.strides[3]) * size, 1,
+                        image->pixels + r * rowlength + c, a.d, a.w);
+                }
+            }
+            return;
+        }
+        // transposed (fortran order) frame: each sample of the columns of this band of rows
+        // is read in the order of the file and written with the stride of the rows
+        for (int x = 0; x < a.w; x++) {
+            for (int c = 0; c < a.d; c++) {
+                size_t pos = y * a.strides[1] + x * a.strides[2] + c * a.strides[3];
+                convertSamplesToFloat(a.type, a.bigEndian, src + pos * size, a.strides[1],
+                    image->pixels + (y * a.w + x) * a.d + c, rowlength, rows);
+            }
+        }
+    }
+
+public:
+    NumpyVideoImageProvider(const std::string& filename, int index, const std::shared_ptr<const NumpyArray>& array)
+        : VideoImageProvider(filename, index)
+        , array(array)
+        , scattered(false)
+        , curh(0)
+    {
+    }
+
+    ~NumpyVideoImageProvider() override = default;
+
+    float getProgressPercentage() const override
+    {
+        return image ? (float)curh / image->h : 0.f;
+    }
+
+    void progress() override
+    {
+        if (!image) {
+            if (!array || frame >= (int)array->length) {
+                onFinish(makeError("npy: couldn't read frame"));
+                return;
+            }
+            const NumpyArray& a = *array;
+            const uint8_t* src = a.getFrame(frame);
+            size_t offset = src - a.file->getData();
+            size_t extent = ((a.h - 1) * a.strides[1] + (a.w - 1) * a.strides[2] + (a.d - 1) * a.strides[3] + 1)
+                * a.getSampleSize();
+            bool floats = a.type == SampleType::F32 && !a.bigEndian && a.isFrameContiguous();
+
+            // the data held in memory never changes, float frames are displayed straight from it
+            if (floats && !a.file->followsFile() && reinterpret_cast<uintptr_t>(src) % alignof(float) == 0) {
+                auto image = std::make_shared<Image>(reinterpret_cast<float*>(const_cast<uint8_t*>(src)), a.w, a.h, a.d);
+                image->owner = a.file;
+                onFinish(image);
+                return;
+            }
+
+            scattered = a.file->followsFile() && extent > 2 * (size_t)a.w * a.h * a.d * a.getSampleSize();
+            // the next frame is read from the disk while this one is converted, for the playback
+            if (a.file->followsFile() && !scattered && frame + 1 < (int)a.length) {
+                a.file->willNeed(offset + a.strides[0] * a.getSampleSize(), extent);
+            }
+
+            float* pixels = (float*)malloc(sizeof(float) * a.w * a.h * a.d);
+            if (floats) {
+                if (!a.file->read(offset, extent, pixels)) {
+                    free(pixels);
+                    onFinish(makeError("npy: couldn't read frame"));
+                    return;
+                }
+                onFinish(std::make_shared<Image>(pixels, a.w, a.h, a.d));
+                return;
+            }
+            if (a.file->followsFile() && !scattered) {
+                samples.resize(extent);
+                if (!a.file->read(offset, extent, samples.data())) {
+                    free(pixels);
+                    onFinish(makeError("npy: couldn't read frame"));
+                    return;
+                }
+            }
+            image = std::make_shared<Image>(pixels, a.w, a.h, a.d, 0.f, 1.f);
+            setProvisionalImage(image);
+        }
+
+        if (curh < (int)image->h) {
+            // bands of rows, so that the columns of a transposed frame stay in the cache while they are read
+            int band = array->isFrameContiguous() || array->strides[2] == 1 ? 1 : 64;
+            ProgressBudget budget;
+            do {
+                int rows = std::min(band, (int)image->h - curh);
+                if (scattered && !holdsRows(curh, rows)) {
+                    onFinish(makeError("npy: couldn't read frame"));
+                    image = nullptr;
+                    return;
+                }
+                convertRows(curh, rows);
+                curh += rows;
+            } while (curh < (int)image->h && !budget.exhausted());
+            image->setValidRows(curh);
+        } else {
+            image->complete();
+            onFinish(image);
+            image = nullptr;
+            samples = std::vector<uint8_t>();
+        }
+    }
+};
+
+// Layout of a headerless file, given on the command line:
+// raw:w=4096,h=3072,c=1,type=u16le,layout=planar,offset=0,frames=auto:/path/to/dump.bin
+struct RawParameters {
+    int w = 0;
+    int h = 0;
+    int c = 1;
+    SampleType type = SampleType::U8;
+    bool bigEndian = false;
+    bool planar = false;
+    // bytes before the first frame
+    size_t offset = 0;
+    // 0 for all the frames in the file
+    size_t frames = 0;
+};
+
+// u8, i16, f32..., followed by le or be (little-endian by default)
+static bool parseSampleType(std::string name, SampleType* type, bool* bigEndian)
+{
+    static const struct {
+        const char* name;
+        SampleType type;
+    } types[] = {
+        { "u8", SampleType::U8 }, { "i8", SampleType::I8 }, { "u16", SampleType::U16 }, { "i16", SampleType::I16 },
+        { "u32", SampleType::U32 }, { "i32", SampleType::I32 }, { "u64", SampleType::U64 }, { "i64", SampleType::I64 },
+        { "f16", SampleType::F16 }, { "f32", SampleType::F32 }, { "f64", SampleType::F64 },
+    };
+
+    *bigEndian = endswith(name, "be");
+    if (endswith(name, "le") || endswith(name, "be"))
+        name.resize(name.size() - 2);
+    for (const auto& t : types) {
+        if (name == t.name) {
+            *type = t.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+// the parameters are separated by commas, returns false (with a message) if one of them is invalid
+static bool parseRawParameters(const std::string& params, RawParameters* raw)
+{
+    std::istringstream ss(params);
+    std::string param;
+    while (std::getline(ss, param, ',')) {
+        size_t eq = param.find('=');
+        std::string key = param.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : param.substr(eq + 1);
+        bool ok = true;
+        if (key == "w" || key == "h" || key == "c") {
+            int v = atoi(value.c_str());
+            ok = v > 0;
+            (key == "w" ? raw->w : key == "h" ? raw->h : raw->c) = v;
+        } else if (key == "type") {
+            ok = parseSampleType(value, &raw->type, &raw->bigEndian);
+        } else if (key == "layout") {
+            ok = value == "planar" || value == "interleaved";
+            raw->planar = value == "planar";
+        } else if (key == "offset") {
+            raw->offset = strtoull(value.c_str(), nullptr, 10);
+        } else if (key == "frames") {
+            raw->frames = value == "auto" ? 0 : strtoull(value.c_str(), nullptr, 10);
+            ok = value == "auto" || raw->frames > 0;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "[raw] invalid parameter '%s'\n", param.c_str());
+            return false;
+        }
+    }
+    if (!raw->w || !raw->h) {
+        fprintf(stderr, "[raw] the width and height are required (w=...,h=...)\n");
+        return false;
+    }
+    return true;
+}
+
+TEST_CASE("parseRawParameters")
+{
+    RawParameters raw;
+    CHECK(parseRawParameters("w=4096,h=3072,c=2,type=u16be,layout=planar,offset=128,frames=10", &raw));
+    CHECK(raw.w == 4096);
+    CHECK(raw.h == 3072);
+    CHECK(raw.c == 2);
+    CHECK(raw.type == SampleType::U16);
+    CHECK(raw.bigEndian);
+    CHECK(raw.planar);
+    CHECK(raw.offset == 128);
+    CHECK(raw.frames == 10);
+
+    RawParameters f32;
+    CHECK(parseRawParameters("w=3,h=2,type=f32,frames=auto", &f32));
+    CHECK(f32.type == SampleType::F32);
+    CHECK(!f32.bigEndian);
+    CHECK(f32.frames == 0);
+
+    RawParameters invalid;
+    CHECK(!parseRawParameters("w=3,h=2,type=u12", &invalid));
+    RawParameters noheight;
+    CHECK(!parseRawParameters("w=3", &noheight));
+}
+
+// frames of 'file' laid out as described by the parameters
+static std::shared_ptr<const NumpyArray> makeRawArray(const std::shared_ptr<MappedFile>& file, const RawParameters& raw)
+{
+    auto array = std::make_shared<NumpyArray>();
+    array->file = file;
+    array->type = raw.type;
+    array->bigEndian = raw.bigEndian;
+    array->w = raw.w;
+    array->h = raw.h;
+    array->d = raw.c;
+    array->offset = raw.offset;
+    size_t framesize = (size_t)raw.w * raw.h * raw.c;
+    array->strides[0] = framesize;
+    if (raw.planar) {
+        array->strides[1] = raw.w;
+        array->strides[2] = 1;
+        array->strides[3] = (size_t)raw.w * raw.h;
+    } else {
+        array->strides[1] = (size_t)raw.w * raw.c;
+        array->strides[2] = raw.c;
+        array->strides[3] = 1;
+    }
+    // only the complete frames are shown
+    size_t available = (file->getSize() - std::min(file->getSize(), raw.offset)) / array->getSampleSize();
+    array->length = available / framesize;
+    if (raw.frames) {
+        array->length = std::min(array->length, raw.frames);
+    }
+    return array;
+}
+
+static std::shared_ptr<const NumpyArray> loadRawArray(const std::string& filename, const RawParameters& raw)
+{
+    std::shared_ptr<MappedFile> file = MappedFile::open(filename);
+    if (!file) {
+        fprintf(stderr, "[raw] file '%s' does not exist\n", filename.c_str());
+        return nullptr;
+    }
+    return makeRawArray(file, raw);
+}
+
+class RawVideoImageCollection : public VideoImageCollection {
+    struct State {
+        std::mutex mutex;
+        std::shared_ptr<const NumpyArray> array;
+        bool watched;
+    };
+    // the file, the collection's filename being the whole expression (so that the keys depend on the parameters)
+    std::string path;
+    RawParameters raw;
+    // shared with the watcher callback, which can outlive the collection
+    std::shared_ptr<State> state;
+
+public:
+    RawVideoImageCollection(const std::string& expression, const std::string& path, const RawParameters& raw)
+        : VideoImageCollection(expression)
+        , path(path)
+        , raw(raw)
+        , state(std::make_shared<State>())
+    {
+        if (!path.empty()) {
+            state->array = loadRawArray(path, raw);
+        }
+        state->watched = false;
+    }
+
+    ~RawVideoImageCollection() override = default;
+
+    int getLength() const override
+    {
+        std::lock_guard<std::mutex> _lock(state->mutex);
+        return state->array ? state->array->length : 0;
+    }
+
+    std::shared_ptr<ImageProvider> getImageProvider(int index) const override
+    {
+        std::string key = getKey(index);
+        std::string expression = this->filename;
+        std::string path = this->path;
+        RawParameters raw = this->raw;
+        std::shared_ptr<State> state = this->state;
+        auto provider = [key, expression, path, raw, state, index]() {
+            std::lock_guard<std::mutex> _lock(state->mutex);
+            if (!state->watched) {
+                state->watched = true;
+                watcher_add_file(path, [expression, path, raw, state](const std::string& fname) {
+                    {
+                        std::lock_guard<std::mutex> _lock(state->mutex);
+                        forgetVideoFrames(expression, state->array ? state->array->length : 0);
+                        state->array = loadRawArray(path, raw);
+                    }
+                    onLengthChange();
+                });
+            }
+            return std::make_shared<NumpyVideoImageProvider>(path, index, state->array);
+        };
+        return getCacheImageProvider(key, provider);
+    }
+};
+
+// raw:<parameters>:<file>
+static std::shared_ptr<ImageCollection> buildRawCollection(const std::string& expression)
+{
+    size_t sep = expression.find(':', 4);
+    std::string path = sep == std::string::npos ? "" : expression.substr(sep + 1);
+    RawParameters raw;
+    if (path.empty()) {
+        fprintf(stderr, "[raw] missing file in '%s'\n", expression.c_str());
+    } else if (!parseRawParameters(expression.substr(4, sep - 4), &raw)) {
+        // an empty sequence, the file can't be interpreted
+        path.clear();
+    }
+    return std::make_shared<RawVideoImageCollection>(expression, path, raw);
+}
+
+#ifdef USE_IIO_NPY
+extern "C" {
+#include <npy.h>
+}
+#include <zlib.h>
+
+// complex numbers are two samples of the type (real and imaginary parts)
+static bool getNumpySampleType(const char* descr, SampleType* type, bool* bigEndian, bool* complex)
+{
+    static const struct {
+        const char* desc;
+        SampleType type;
+    } types[] = {
+        { "b1", SampleType::U8 }, { "u1", SampleType::U8 }, { "i1", SampleType::I8 },
+        { "u2", SampleType::U16 }, { "i2", SampleType::I16 }, { "u4", SampleType::U32 },
+        { "i4", SampleType::I32 }, { "u8", SampleType::U64 }, { "i8", SampleType::I64 },
+        { "f2", SampleType::F16 }, { "f4", SampleType::F32 }, { "f8", SampleType::F64 },
+        { "c8", SampleType::F32 }, { "c16", SampleType::F64 },
+    };
+    *bigEndian = descr[0] == '>';
+    if (descr[0] == '<' || descr[0] == '>' || descr[0] == '=' || descr[0] == '|')
+        descr++;
+    for (const auto& t : types) {
+        if (!strcmp(descr, t.desc)) {
+            *type = t.type;
+            *complex = descr[0] == 'c';
+            return true;
+        }
+    }
+    return false;
+}
+
+// layout of an array whose npy header starts at 'offset' in 'file' (name is only used for the messages)
+// without file, only the layout is set
+// 'size' bytes of the .npy are available, header included: a file which is still being written ('growing')
+// only exposes its complete frames, the other truncated arrays are rejected
+static std::shared_ptr<const NumpyArray> makeNumpyArray(const std::string& name, const struct npy_info& header,
+    const std::shared_ptr<MappedFile>& file, size_t offset, size_t size, bool growing)
+{
+    auto array = std::make_shared<NumpyArray>();
+    bool complex;
+    if (!getNumpySampleType(header.desc, &array->type, &array->bigEndian, &complex)) {
+        fprintf(stderr, "[npy] unsupported type '%s' in '%s'\n", header.desc, name.c_str());
+        return nullptr;
+    }
+    // the parser appends an axis for the parts of complex numbers, they are placed with the channels below
+    struct npy_info ni = header;
+    if (complex)
+        ni.ndims--;
+
+    // dimension of the array holding the frames, rows, columns and channels (-1 if there is none)
+    int axes[4];
+    if (ni.ndims == 1) {
+        axes[0] = -1, axes[1] = -1, axes[2] = 0, axes[3] = -1;
+    } else if (ni.ndims == 2) {
+        axes[0] = -1, axes[1] = 0, axes[2] = 1, axes[3] = -1;
+    } else if (ni.ndims == 3 && ni.dims[2] < ni.dims[0] && ni.dims[2] < ni.dims[1]) {
+        axes[0] = -1, axes[1] = 0, axes[2] = 1, axes[3] = 2;
+    } else if (ni.ndims == 3) {
+        axes[0] = 0, axes[1] = 1, axes[2] = 2, axes[3] = -1;
+    } else if (ni.ndims == 4) {
+        axes[0] = 0, axes[1] = 1, axes[2] = 2, axes[3] = 3;
+    } else {
+        fprintf(stderr, "[npy] unsupported number of dimensions (%d) in '%s'\n", ni.ndims, name.c_str());
+        return nullptr;
+    }
+
+    // the first dimension varies the fastest in fortran order, the last one in C order
+    size_t dimstrides[4];
+    size_t total = 1;
+    for (int i = 0; i < ni.ndims; i++) {
+        int dim = ni.fortran_order ? i : ni.ndims - 1 - i;
+        dimstrides[dim] = total;
+        if (ni.dims[dim] && total > std::numeric_limits<size_t>::max() / 2 / array->getSampleSize() / ni.dims[dim]) {
+            fprintf(stderr, "[npy] the dimensions of '%s' are too large\n", name.c_str());
+            return nullptr;
+        }
+        total *= ni.dims[dim];
+    }
+    size_t sizes[4];
+    for (int a = 0; a < 4; a++) {
+        sizes[a] = axes[a] >= 0 ? ni.dims[axes[a]] : 1;
+        array->strides[a] = axes[a] >= 0 ? dimstrides[axes[a]] : total;
+    }
+    if (complex) {
+        // the real and imaginary parts are two channels, next to those of the array
+        if (sizes[3] != 1 && array->strides[3] != 1) {
+            fprintf(stderr, "[npy] the channels of the complex array '%s' are not contiguous\n", name.c_str());
+            return nullptr;
+        }
+        for (int a = 0; a < 4; a++)
+            array->strides[a] *= 2;
+        array->strides[3] = 1;
+        sizes[3] *= 2;
+        total *= 2;
+    }
+    array->length = sizes[0];
+    array->h = sizes[1];
+    array->w = sizes[2];
+    array->d = sizes[3];
+    array->file = file;
+    array->offset = offset + ni.header_offset;
+
+    size_t available = (size - std::min(size, ni.header_offset)) / array->getSampleSize();
+    if (available < total && !growing) {
+        fprintf(stderr, "[npy] '%s' is truncated\n", name.c_str());
+        return nullptr;
+    }
+    if (available < total) {
+        size_t framesize = (size_t)array->w * array->h * array->d;
+        array->length = ni.fortran_order ? 0 : std::min(array->length, available / framesize);
+        fprintf(stderr, "[npy] '%s' is truncated\n", name.c_str());
+    }
+
+    printf("opened numpy array '%s', assuming size: (n=%lu, h=%d, w=%d, d=%d), type=%s%s\n",
+        name.c_str(), array->length, array->h, array->w, array->d, ni.desc,
+        ni.fortran_order ? " (fortran order)" : "");
+    return array;
+}
+
+static std::shared_ptr<const NumpyArray> loadNumpyArray(const std::string& filename)
+{
+    std::shared_ptr<MappedFile> file = MappedFile::open(filename);
+    if (!file) {
+        fprintf(stderr, "[npy] file '%s' does not exist\n", filename.c_str());
+        return nullptr;
+    }
+    struct npy_info ni;
+    if (!npy_parse_header(file->getData(), file->getSize(), &ni)) {
+        fprintf(stderr, "[npy] error while loading header of '%s'\n", filename.c_str());
+        return nullptr;
+    }
+    return makeNumpyArray(filename, ni, file, 0, file->getSize(), true);
+}
+
+class NumpyVideoImageCollection : public VideoImageCollection {
+    struct State {
+        std::mutex mutex;
+        std::shared_ptr<const NumpyArray> array;
+        bool watched;
+    };
+    // shared with the watcher callback, which can outlive the collection
+    std::shared_ptr<State> state;
+
+public:
+    NumpyVideoImageCollection(const std::string& filename)
+        : VideoImageCollection(filename)
+        , state(std::make_shared<State>())
+    {
+        state->array = loadNumpyArray(filename);
+        state->watched = false;
+    }
+
+    ~NumpyVideoImageCollection() override = default;
+
+    int getLength() const override
+    {
+        std::lock_guard<std::mutex> _lock(state->mutex);
+        return state->array ? state->array->length : 0;
+    }
+
+    std::shared_ptr<ImageProvider> getImageProvider(int index) const override
+    {
+        std::string key = getKey(index);
+        std::string filename = this->filename;
+        std::shared_ptr<State> state = this->state;
+        auto provider = [key, filename, state, index]() {
+            std::lock_guard<std::mutex> _lock(state->mutex);
+            if (!state->watched) {
+                state->watched = true;
+                watcher_add_file(filename, [filename, state](const std::string& fname) {
+                    {
+                        std::lock_guard<std::mutex> _lock(state->mutex);
+                        forgetVideoFrames(filename, state->array ? state->array->length : 0);
+                        // the providers which are still loading keep the previous mapping
+                        state->array = loadNumpyArray(filename);
+                    }
+                    onLengthChange();
+                });
+            }
+            return std::make_shared<NumpyVideoImageProvider>(filename, index, state->array);
+        };
+        return getCacheImageProvider(key, provider);
+    }
+};
+
+// little-endian fields of the zip structures
+static uint16_t zip16(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t zip32(const uint8_t* p)
+{
+    return zip16(p) | ((uint32_t)zip16(p + 2) << 16);
+}
+
+static uint64_t zip64(const uint8_t* p)
+{
+    return zip32(p) | ((uint64_t)zip32(p + 4) << 32);
+}
+
+// A .npy member of a .npz archive (np.savez or np.savez_compressed).
+struct NpzMember {
+    std::string name;
+    bool deflated;
+    // position of the (compressed) data in the archive
+    size_t offset;
+    size_t compressedSize;
+    // bytes of the .npy, header and samples (the member itself can have trailing bytes)
+    size_t size;
+    // for deflated members, the layout is known from the header, but the samples are in the inflated data
+    struct npy_info ni;
+    std::shared_ptr<const NumpyArray> array;
+};
+
+// deflate can't compress more than this (258 bytes per 2 bits of code)
+static const size_t maxDeflateRatio = 1032;
+
+// inflates the beginning of a deflated member (at most 'size' bytes), for its header
+static std::vector<uint8_t> inflatePrefix(const uint8_t* src, size_t srcsize, size_t size)
+{
+    std::vector<uint8_t> out(size);
+    z_stream zs = {};
+    // raw deflate, without the zlib header
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+        return {};
+    zs.next_in = const_cast<Bytef*>(src);
+    zs.avail_in = std::min<size_t>(srcsize, 1 << 30);
+    zs.next_out = out.data();
+    zs.avail_out = size;
+    inflate(&zs, Z_SYNC_FLUSH);
+    out.resize(size - zs.avail_out);
+    inflateEnd(&zs);
+    return out;
+}
+
+// members of a zip archive which are npy arrays, in the order of the central directory
+static std::vector<NpzMember> indexNpzArchive(const std::string& filename, const std::shared_ptr<MappedFile>& file)
+{
+    std::vector<NpzMember> members;
+    const uint8_t* data = file->getData();
+    size_t size = file->getSize();
+
+    // the end of central directory record is followed by a comment of at most 64KB
+    const uint8_t* eocd = nullptr;
+    for (size_t pos = size >= 22 ? size - 22 : 0; size >= 22 && pos + 22 + 0xffff >= size; pos--) {
+        if (zip32(data + pos) == 0x06054b50) {
+            eocd = data + pos;
+            break;
+        }
+        if (!pos)
+            break;
+    }
+    if (!eocd) {
+        fprintf(stderr, "[npz] '%s' is not a zip archive\n", filename.c_str());
+        return members;
+    }
+    uint64_t entries = zip16(eocd + 10);
+    uint64_t cdoffset = zip32(eocd + 16);
+    // zip64 archives have a second record, found through a locator just before the first one
+    const uint8_t* locator = eocd - 20;
+    if (eocd - data >= 20 && zip32(locator) == 0x07064b50) {
+        uint64_t recordOffset = zip64(locator + 8);
+        if (recordOffset + 56 <= size && zip32(data + recordOffset) == 0x06064b50) {
+            entries = zip64(data + recordOffset + 32);
+            cdoffset = zip64(data + recordOffset + 48);
+        }
+    }
+
+    size_t pos = cdoffset;
+    for (uint64_t i = 0; i < entries; i++) {
+        if (pos + 46 > size || zip32(data + pos) != 0x02014b50)
+            break;
+        const uint8_t* entry = data + pos;
+        uint16_t flags = zip16(entry + 8);
+        uint16_t method = zip16(entry + 10);
+        uint64_t compressedSize = zip32(entry + 20);
+        uint64_t uncompressedSize = zip32(entry + 24);
+        uint16_t namelen = zip16(entry + 28);
+        uint16_t extralen = zip16(entry + 30);
+        uint16_t commentlen = zip16(entry + 32);
+        uint64_t localOffset = zip32(entry + 42);
+        pos += 46 + namelen + extralen + commentlen;
+        if (pos > size)
+            break;
+        std::string name(reinterpret_cast<const char*>(entry + 46), namelen);
+
+        // the zip64 extra field holds the values which do not fit in the entry
+        const uint8_t* extra = entry + 46 + namelen;
+        for (const uint8_t* e = extra; e + 4 <= extra + extralen;) {
+            uint16_t id = zip16(e);
+            uint16_t len = zip16(e + 2);
+            if (e + 4 + len > extra + extralen)
+                break;
+            if (id == 0x0001) {
+                const uint8_t* v = e + 4;
+                if (uncompressedSize == 0xffffffff && v + 8 <= e + 4 + len)
+                    uncompressedSize = zip64(v), v += 8;
+                if (compressedSize == 0xffffffff && v + 8 <= e + 4 + len)
+                    compressedSize = zip64(v), v += 8;
+                if (localOffset == 0xffffffff && v + 8 <= e + 4 + len)
+                    localOffset = zip64(v), v += 8;
+            }
+            e += 4 + len;
+        }
+
+        if (!endswith(name, ".npy") || (flags & 1) || (method != 0 && method != 8))
+            continue;
+        if (localOffset + 30 > size || zip32(data + localOffset) != 0x04034b50)
+            continue;
+        // the extra field of the local header can differ from the one of the central directory
+        size_t dataOffset = localOffset + 30 + zip16(data + localOffset + 26) + zip16(data + localOffset + 28);
+        if (dataOffset + compressedSize > size)
+            continue;
+
+        NpzMember member;
+        member.name = name.substr(0, name.size() - 4);
+        member.deflated = method == 8;
+        member.offset = dataOffset;
+        member.compressedSize = compressedSize;
+        member.size = uncompressedSize;
+        std::string fullname = filename + ":" + member.name;
+        if (member.deflated) {
+            // npy 1.0 headers are at most 10+65535 bytes
+            std::vector<uint8_t> header = inflatePrefix(data + dataOffset, compressedSize,
+                std::min<size_t>(uncompressedSize, 10 + 0xffff));
+            if (!npy_parse_header(header.data(), header.size(), &member.ni)) {
+                fprintf(stderr, "[npz] error while loading header of '%s'\n", fullname.c_str());
+                continue;
+            }
+            member.array = makeNumpyArray(fullname, member.ni, nullptr, 0, uncompressedSize, false);
+        } else {
+            if (!npy_parse_header(data + dataOffset, compressedSize, &member.ni)) {
+                fprintf(stderr, "[npz] error while loading header of '%s'\n", fullname.c_str());
+                continue;
+            }
+            member.array = makeNumpyArray(fullname, member.ni, file, dataOffset, compressedSize, false);
+        }
+        if (!member.array)
+            continue;
+        // only the data of the array is inflated (the member can't be larger than it was announced)
+        const NumpyArray& a = *member.array;
+        member.size = member.ni.header_offset + a.length * a.w * a.h * a.d * a.getSampleSize();
+        if (member.deflated && member.size / maxDeflateRatio > compressedSize) {
+            fprintf(stderr, "[npz] '%s' is too large for its compressed data\n", fullname.c_str());
+            continue;
+        }
+        members.push_back(member);
+    }
+    return members;
+}
+
+// Inflates a deflated member, a slice at a time, in the loader threads.
+// The frames of the member share it, and use the inflated data as the file of their array.
+// The compressed data is read in chunks, not through the mapping, as the archive can be rewritten meanwhile.
+class NpzInflater {
+    std::mutex mutex;
+    std::shared_ptr<MappedFile> archive;
+    NpzMember member;
+    z_stream zs;
+    bool started;
+    // chunk of the compressed data, and the bytes of the member read so far
+    std::vector<uint8_t> input;
+    size_t read;
+    std::atomic<bool> done;
+    // bytes inflated so far, read by the UI thread without the mutex (zs belongs to the loader)
+    std::atomic<size_t> inflated;
+    std::vector<uint8_t> buffer;
+    std::shared_ptr<const NumpyArray> array;
+
+    void finish(bool ok)
+    {
+        inflateEnd(&zs);
+        if (ok) {
+            auto inflated = std::make_shared<NumpyArray>(*member.array);
+            inflated->file = MappedFile::fromBuffer(std::move(buffer));
+            inflated->offset = member.ni.header_offset;
+            array = inflated;
+        }
+        buffer = std::vector<uint8_t>();
+        input = std::vector<uint8_t>();
+        done = true;
+    }
+
+public:
+    NpzInflater(const std::shared_ptr<MappedFile>& archive, const NpzMember& member)
+        : archive(archive)
+        , member(member)
+        , zs()
+        , started(false)
+        , read(0)
+        , done(false)
+        , inflated(0)
+    {
+    }
+
+    ~NpzInflater()
+    {
+        if (started && !done) {
+            inflateEnd(&zs);
+        }
+    }
+
+    float getProgressPercentage() const
+    {
+        return done ? 1.f : member.size ? (float)inflated / member.size : 0.f;
+    }
+
+    // returns true once the member is inflated (or failed to)
+    bool progress()
+    {
+        std::lock_guard<std::mutex> _lock(mutex);
+        if (done)
+            return true;
+        if (!started) {
+            if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+                done = true;
+                return true;
+            }
+            started = true;
+            buffer.resize(member.size);
+            input.resize(std::min<size_t>(member.compressedSize, 1 << 20));
+            zs.next_out = buffer.data();
+        }
+
+        ProgressBudget budget;
+        do {
+            if (!zs.avail_in && read < member.compressedSize) {
+                size_t n = std::min(input.size(), member.compressedSize - read);
+                if (!archive->read(member.offset + read, n, input.data())) {
+                    finish(false);
+                    return true;
+                }
+                read += n;
+                zs.next_in = input.data();
+                zs.avail_in = n;
+            }
+            // zlib counts in 32 bits
+            size_t out = member.size - zs.total_out;
+            zs.avail_out = std::min<size_t>(out, 1 << 22);
+            int r = inflate(&zs, Z_NO_FLUSH);
+            inflated = zs.total_out;
+            // the data of the array is complete, whatever follows it
+            if (zs.total_out == member.size) {
+                finish(true);
+                return true;
+            }
+            if (r != Z_OK) {
+                finish(false);
+                return true;
+            }
+        } while (!budget.exhausted());
+        return false;
+    }
+
+    // nullptr if the member could not be inflated
+    std::shared_ptr<const NumpyArray> getArray() const
+    {
+        return array;
+    }
+};
+
+// frame of a deflated member, once the member is inflated
+class NpzVideoImageProvider : public VideoImageProvider {
+    std::shared_ptr<NpzInflater> inflater;
+    std::shared_ptr<NumpyVideoImageProvider> provider;
+
+public:
+    NpzVideoImageProvider(const std::string& filename, int index, const std::shared_ptr<NpzInflater>& inflater)
+        : VideoImageProvider(filename, index)
+        , inflater(inflater)
+    {
+    }
+
+    ~NpzVideoImageProvider() override = default;
+
+    float getProgressPercentage() const override
+    {
+        return provider ? provider->getProgressPercentage() : inflater->getProgressPercentage();
+    }
+
+    std::shared_ptr<Image> getProvisionalImage() const override
+    {
+        return provider ? provider->getProvisionalImage() : nullptr;
+    }
+
+    void progress() override
+    {
+        if (!provider) {
+            if (!inflater->progress())
+                return;
+            std::shared_ptr<const NumpyArray> array = inflater->getArray();
+            if (!array) {
+                onFinish(makeError("npz: couldn't inflate member"));
+                return;
+            }
+            provider = std::make_shared<NumpyVideoImageProvider>(filename, frame, array);
+            inflater = nullptr;
+        }
+        provider->progress();
+        if (provider->isLoaded()) {
+            onFinish(provider->getResult());
+        }
+    }
+};
+
+// The arrays of a .npz archive, one after the other. 3D and 4D arrays contribute one frame per image.
+// Stored members are read from the mapping of the archive, deflated ones are inflated when one of their frames
+// is requested (the last one stays inflated, so that playing its frames does not inflate it again).
+class NpzVideoImageCollection : public VideoImageCollection {
+    struct State {
+        std::mutex mutex;
+        std::shared_ptr<MappedFile> archive;
+        std::vector<NpzMember> members;
+        std::vector<std::weak_ptr<NpzInflater>> inflaters;
+        std::shared_ptr<NpzInflater> lastInflater;
+        bool watched;
+
+        void load(const std::string& filename)
+        {
+            archive = MappedFile::open(filename);
+            members.clear();
+            if (archive) {
+                members = indexNpzArchive(filename, archive);
+            } else {
+                fprintf(stderr, "[npz] file '%s' does not exist\n", filename.c_str());
+            }
+            inflaters.assign(members.size(), std::weak_ptr<NpzInflater>());
+            lastInflater = nullptr;
+        }
+
+        int getLength() const
+        {
+            int length = 0;
+            for (const auto& m : members) {
+                length += m.array->length;
+            }
+            return length;
+        }
+    };
+    // shared with the watcher callback, which can outlive the collection
+    std::shared_ptr<State> state;
+
+public:
+    NpzVideoImageCollection(const std::string& filename)
+        : VideoImageCollection(filename)
+        , state(std::make_shared<State>())
+    {
+        state->load(filename);
+        state->watched = false;
+    }
+
+    ~NpzVideoImageCollection() override = default;
+
+    int getLength() const override
+    {
+        std::lock_guard<std::mutex> _lock(state->mutex);
+        return state->getLength();
+    }
+
+    std::shared_ptr<ImageProvider> getImageProvider(int index) const override
+    {
+        std::string key = getKey(index);
+        std::string filename = this->filename;
+        std::shared_ptr<State> state = this->state;
+        auto provider = [key, filename, state, index]() -> std::shared_ptr<ImageProvider> {
+            std::lock_guard<std::mutex> _lock(state->mutex);
+            if (!state->watched) {
+                state->watched = true;
+                watcher_add_file(filename, [filename, state](const std::string& fname) {
+                    {
+                        std::lock_guard<std::mutex> _lock(state->mutex);
+                        forgetVideoFrames(filename, state->getLength());
+                        state->load(filename);
+                    }
+                    onLengthChange();
+                });
+            }
+
+            int frame = index;
+            for (size_t m = 0; m < state->members.size(); m++) {
+                const NpzMember& member = state->members[m];
+                if (frame >= (int)member.array->length) {
+                    frame -= member.array->length;
+                    continue;
+                }
+                if (!member.deflated) {
+                    return std::make_shared<NumpyVideoImageProvider>(filename, frame, member.array);
+                }
+                std::shared_ptr<NpzInflater> inflater = state->inflaters[m].lock();
+                if (!inflater) {
+                    inflater = std::make_shared<NpzInflater>(state->archive, member);
+                    state->inflaters[m] = inflater;
+                }
+                state->lastInflater = inflater;
+                return std::make_shared<NpzVideoImageProvider>(filename, frame, inflater);
+            }
+            return std::make_shared<NumpyVideoImageProvider>(filename, index, nullptr);
+        };
+        return getCacheImageProvider(key, provider);
+    }
+};
+#endif
+
+// Bytes of a pipe, read by the thread of a PipeVideoImageCollection
+class PipeSource {
+protected:
+    std::atomic<bool> interrupted;
+
+public:
+    PipeSource()
+        : interrupted(false)
+    {
+    }
+
+    virtual ~PipeSource() = default;
+
+    // reads up to 'size' bytes, 0 at the end of the stream (or once interrupted)
+    virtual size_t read(uint8_t* buffer, size_t size) = 0;
+
+    // makes the pending and next reads return 0, can be called from any thread
+    void interrupt()
+    {
+        interrupted = true;
+    }
+};
+
+// standard output of a shell command, its standard error goes to the terminal
+class CommandPipeSource : public PipeSource {
+    reproc::process process;
+
+public:
+    CommandPipeSource(const std::string& command)
+    {
+        reproc::options options;
+        options.stop = {
+            { reproc::stop::terminate, reproc::milliseconds(50) },
+            { reproc::stop::kill, reproc::milliseconds(50) },
+            {},
+        };
+        options.redirect.in.type = reproc::redirect::discard;
+        options.redirect.err.type = reproc::redirect::parent;
+        const char* args[] = { "sh", "-c", command.c_str(), nullptr };
+        std::error_code ec = process.start(args, options);
+        if (ec) {
+            fprintf(stderr, "[cmd] cannot start '%s': %s\n", command.c_str(), ec.message().c_str());
+            interrupt();
+        }
+    }
+
+    // the process is stopped by the destructor of reproc::process
+    ~CommandPipeSource() override = default;
+
+    size_t read(uint8_t* buffer, size_t size) override
+    {
+        // the process can't be stopped while it is being read, so the reads wait for data a bit at a time
+        while (!interrupted) {
+            auto polled = process.poll(reproc::event::out, reproc::milliseconds(100));
+            if (polled.second == std::errc::timed_out)
+                continue;
+            if (polled.second)
+                return 0;
+            auto res = process.read(reproc::stream::out, buffer, size);
+            return res.second ? 0 : res.first;
+        }
+        return 0;
+    }
+};
+
+#ifndef WINDOWS
+// standard input of vpv (-)
+class StdinPipeSource : public PipeSource {
+public:
+    size_t read(uint8_t* buffer, size_t size) override
+    {
+        while (!interrupted) {
+            struct pollfd fd = { 0, POLLIN, 0 };
+            int r = poll(&fd, 1, 100);
+            if (r == 0 || (r < 0 && errno == EINTR))
+                continue;
+            if (r < 0)
+                return 0;
+            ssize_t n = ::read(0, buffer, size);
+            if (n < 0 && errno == EINTR)
+                continue;
+            return n > 0 ? n : 0;
+        }
+        return 0;
+    }
+};
+#endif
+
+// reads exactly 'size' bytes, false at the end of the stream
+static bool readPipe(PipeSource& source, uint8_t* buffer, size_t size)
+{
+    while (size) {
+        size_t n = source.read(buffer, size);
+        if (!n)
+            return false;
+        buffer += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Layout of the frames of a pipe: given with raw:<parameters>, or found at the start of the stream
+struct PipeLayout {
+    bool known = false;
+    bool npy = false;
+    // other data is decoded by iio as a single image, at the end of the stream
+    bool iio = false;
+    RawParameters raw;
+#ifdef USE_IIO_NPY
+    // header of the last .npy array and its layout, most streams repeat the same header
+    std::vector<uint8_t> header;
+    std::shared_ptr<const NumpyArray> array;
+#endif
+};
+
+#if defined(USE_IIO) && !defined(WINDOWS)
+// the whole stream, as an image decoded by iio (which only reads files)
+static std::shared_ptr<const NumpyArray> readPipeImage(PipeSource& source, const uint8_t* magic, size_t size,
+    const std::string& name)
+{
+    std::vector<uint8_t> data(magic, magic + size);
+    uint8_t buffer[1 << 16];
+    while (size_t n = source.read(buffer, sizeof(buffer))) {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+
+    // a name of our own, the temporary directory is shared with the other users
+    std::error_code ec;
+    std::string tmpl = (fs::temp_directory_path(ec) / "vpv-pipe-XXXXXX").u8string();
+    std::vector<char> pathname(tmpl.begin(), tmpl.end());
+    pathname.push_back(0);
+    int fd = ec ? -1 : mkstemp(pathname.data());
+    if (fd < 0) {
+        fprintf(stderr, "[pipe] cannot create a temporary file for '%s'\n", name.c_str());
+        return nullptr;
+    }
+    fs::path path(pathname.data());
+    FILE* file = fdopen(fd, "wb");
+    bool written = file && fwrite(data.data(), 1, data.size(), file) == data.size();
+    if (file ? fclose(file) : close(fd)) {
+        written = false;
+    }
+    if (!written) {
+        fprintf(stderr, "[pipe] cannot write '%s'\n", path.u8string().c_str());
+        fs::remove(path, ec);
+        return nullptr;
+    }
+    int w, h, d;
+    float* pixels = iio_read_image_float_vec(path.u8string().c_str(), &w, &h, &d);
+    fs::remove(path, ec);
+    if (!pixels) {
+        fprintf(stderr, "[pipe] cannot read the image of '%s'\n", name.c_str());
+        return nullptr;
+    }
+
+    RawParameters raw;
+    raw.w = w;
+    raw.h = h;
+    raw.c = d;
+    raw.type = SampleType::F32;
+    std::vector<uint8_t> samples(reinterpret_cast<uint8_t*>(pixels), reinterpret_cast<uint8_t*>(pixels + (size_t)w * h * d));
+    free(pixels);
+    return makeRawArray(MappedFile::fromBuffer(std::move(samples)), raw);
+}
+#endif
+
+// next frames of the stream, in an array which owns them, nullptr at the end of the stream
+static std::shared_ptr<const NumpyArray> readPipeArray(PipeSource& source, PipeLayout& layout, const std::string& name)
+{
+    uint8_t magic[4];
+    bool magicRead = false;
+    if (!layout.known) {
+        if (!readPipe(source, magic, sizeof(magic)))
+            return nullptr;
+        magicRead = true;
+        if (!memcmp(magic, "VPP", 4)) {
+            int dims[3];
+            if (!readPipe(source, reinterpret_cast<uint8_t*>(dims), sizeof(dims)))
+                return nullptr;
+            if (dims[0] <= 0 || dims[1] <= 0 || dims[2] <= 0) {
+                fprintf(stderr, "[pipe] invalid VPP size %dx%dx%d in '%s'\n", dims[0], dims[1], dims[2], name.c_str());
+                return nullptr;
+            }
+            layout.raw.w = dims[0];
+            layout.raw.h = dims[1];
+            layout.raw.c = dims[2];
+            layout.raw.type = SampleType::F32;
+            magicRead = false;
+#ifdef USE_IIO_NPY
+        } else if (!memcmp(magic, "\x93NUM", 4)) {
+            layout.npy = true;
+#endif
+#if defined(USE_IIO) && !defined(WINDOWS)
+        } else if (layout.iio) {
+            // the next call finds the end of the stream
+            return readPipeImage(source, magic, sizeof(magic), name);
+#endif
+        } else {
+            fprintf(stderr, "[cmd] '%s' doesn't output .npy arrays nor a VPP stream, "
+                            "use raw:<parameters>:%s for raw frames\n",
+                name.c_str(), name.c_str());
+            return nullptr;
+        }
+        layout.known = true;
+    }
+
+    if (!layout.npy) {
+        // raw frames, one at a time
+        if (layout.raw.offset) {
+            std::vector<uint8_t> skipped(layout.raw.offset);
+            if (!readPipe(source, skipped.data(), skipped.size()))
+                return nullptr;
+            layout.raw.offset = 0;
+        }
+        size_t size = (size_t)layout.raw.w * layout.raw.h * layout.raw.c * getSampleSize(layout.raw.type);
+        std::vector<uint8_t> buffer(size);
+        if (!readPipe(source, buffer.data(), size))
+            return nullptr;
+        return makeRawArray(MappedFile::fromBuffer(std::move(buffer)), layout.raw);
+    }
+
+#ifdef USE_IIO_NPY
+    // each array has its own header (only version 1.0 is supported)
+    std::vector<uint8_t> header(10);
+    if (magicRead) {
+        memcpy(header.data(), magic, sizeof(magic));
+    } else if (!readPipe(source, header.data(), sizeof(magic))) {
+        return nullptr;
+    }
+    if (memcmp(header.data(), "\x93NUM", 4)) {
+        fprintf(stderr, "[pipe] '%s' outputs something else than a .npy array\n", name.c_str());
+        return nullptr;
+    }
+    if (!readPipe(source, header.data() + 4, 6))
+        return nullptr;
+    header.resize(10 + header[8] + 0x100 * header[9]);
+    if (!readPipe(source, header.data() + 10, header.size() - 10))
+        return nullptr;
+
+    if (header != layout.header) {
+        struct npy_info ni;
+        if (!npy_parse_header(header.data(), header.size(), &ni)) {
+            fprintf(stderr, "[pipe] invalid .npy header in the output of '%s'\n", name.c_str());
+            return nullptr;
+        }
+        layout.array = makeNumpyArray(name, ni, nullptr, 0, std::numeric_limits<size_t>::max(), false);
+        if (!layout.array)
+            return nullptr;
+        layout.header = header;
+    }
+
+    auto array = std::make_shared<NumpyArray>(*layout.array);
+    // the frames are the whole data of the array
+    std::vector<uint8_t> buffer(array->length * array->w * array->h * array->d * array->getSampleSize());
+    if (!readPipe(source, buffer.data(), buffer.size()))
+        return nullptr;
+    array->file = MappedFile::fromBuffer(std::move(buffer));
+    array->offset = 0;
+    return array;
+#else
+    return nullptr;
+#endif
+}
+
+// History of the frames of a pipe, shared by the collection, its providers and the thread which reads the pipe
+struct PipeState {
+    std::mutex mutex;
+    std::condition_variable cond;
+    // frames [first, first + frames.size()) of the stream: an array and the index of the frame in it
+    // (no array for the frames of a shared memory ring which were overwritten before they were read)
+    std::deque<std::pair<std::shared_ptr<const NumpyArray>, int>> frames;
+    int first = 0;
+    // maximum size of the history, in frames (see PIPE_BUFFER)
+    size_t capacity = 2;
+    // frames known to exist, and the length last seen by the players
+    int length = 0;
+    int reported = 0;
+    // frames requested by the providers which did not find them in the history yet
+    std::multiset<int> requests;
+    // frame for which the command has to be started again (-1 if none)
+    int restart = -1;
+    // frames pushed (or end of the stream) by the reader, and the count last seen by pollPipes,
+    // which wakes up the loaders of the providers waiting for them
+    unsigned arrivals = 0;
+    unsigned notified = 0;
+    // whether the stream can be read again (a command, not stdin),
+    // otherwise it is read as fast as it comes and the players follow it
+    bool restartable = true;
+    bool ended = false;
+    bool closed = false;
+    std::shared_ptr<PipeSource> source;
+};
+
+// converts its frame once it is in the history, the loaders set it aside until then (see isWaiting)
+class PipeVideoImageProvider : public VideoImageProvider {
+    std::shared_ptr<PipeState> state;
+    std::shared_ptr<NumpyVideoImageProvider> provider;
+    // set once the frame is in the history, provider is only used by the loading thread
+    std::atomic<bool> found;
+    // whether the frame is in the requests of the state (guarded by its mutex)
+    bool requested;
+
+    // the reader reads ahead up to the last frame requested (and not found yet)
+    void unrequest(PipeState& s)
+    {
+        if (requested) {
+            s.requests.erase(s.requests.find(frame));
+            requested = false;
+            s.cond.notify_all();
+        }
+    }
+
+public:
+    PipeVideoImageProvider(const std::string& filename, int index, const std::shared_ptr<PipeState>& state)
+        : VideoImageProvider(filename, index)
+        , state(state)
+        , found(false)
+        , requested(true)
+    {
+        // the reader is not blocked until a loader gets to this provider
+        std::lock_guard<std::mutex> _lock(state->mutex);
+        state->requests.insert(frame);
+        state->cond.notify_all();
+    }
+
+    ~PipeVideoImageProvider() override
+    {
+        std::lock_guard<std::mutex> _lock(state->mutex);
+        unrequest(*state);
+    }
+
+    float getProgressPercentage() const override
+    {
+        return found ? provider->getProgressPercentage() : 0.f;
+    }
+
+    std::shared_ptr<Image> getProvisionalImage() const override
+    {
+        return found ? provider->getProvisionalImage() : nullptr;
+    }
+
+    bool isWaiting() const override
+    {
+        if (found || isLoaded()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> _lock(state->mutex);
+        const PipeState& s = *state;
+        if (frame >= s.first && frame < s.first + (int)s.frames.size()) {
+            return false;
+        }
+        // otherwise progress() asks for a restart, or reports that the frame is gone or won't come
+        return (frame < s.first && s.restart >= 0) || (frame >= s.first && !s.ended);
+    }
+
+    void progress() override
+    {
+        if (!found) {
+            std::lock_guard<std::mutex> _lock(state->mutex);
+            PipeState& s = *state;
+            if (frame >= s.first && frame < s.first + (int)s.frames.size()) {
+                unrequest(s);
+                const auto& f = s.frames[frame - s.first];
+                if (!f.first) {
+                    onFinish(makeError("shm: frame " + std::to_string(frame) + " was overwritten before it was read"));
+                    return;
+                }
+                provider = std::make_shared<NumpyVideoImageProvider>(filename, f.second, f.first);
+                found = true;
+            } else if (frame < s.first && !s.restartable) {
+                unrequest(s);
+                onFinish(makeError("pipe: frame " + std::to_string(frame) + " left the history (see PIPE_BUFFER)"));
+                return;
+            } else if (frame >= s.first && s.ended) {
+                unrequest(s);
+                onFinish(makeError("pipe: the stream ended before frame " + std::to_string(frame)));
+                return;
+            } else if (frame < s.first) {
+                // the command is started again for the frame (or for another one, then this one asks again)
+                if (s.restart < 0) {
+                    s.restart = frame;
+                    if (s.source)
+                        s.source->interrupt();
+                    s.cond.notify_all();
+                }
+                return;
+            } else {
+                // the frame is on its way, the loaders are notified when it arrives (see pollPipes)
+                return;
+            }
+        }
+        provider->progress();
+        if (provider->isLoaded()) {
+            onFinish(provider->getResult());
+        }
+    }
+};
+
+// Frames of a command (cmd:<command>), of stdin (-) or of a shared memory ring (shm:<name>),
+// read on the fly by a thread into a bounded history.
+// The length of the sequence is the number of frames received so far.
+// The thread only reads a command ahead of the frames which are requested (the command then waits for its pipe
+// to be read), and the command is started again when a frame which already left the history is requested.
+// stdin and the rings are read as soon as possible, so that the producer is never blocked:
+// only its recent frames can be shown.
+class PipeVideoImageCollection : public VideoImageCollection {
+    std::shared_ptr<PipeState> state;
+
+    // collections whose length is polled
+    static std::mutex pipesLock;
+    static std::vector<std::weak_ptr<PipeState>> pipes;
+
+public:
+    using Reader = std::function<void(const std::shared_ptr<PipeState>&)>;
+
+    // 'read' fills the history, on its own thread, until the state is closed
+    PipeVideoImageCollection(const std::string& expression, const Reader& read, bool restartable)
+        : VideoImageCollection(expression)
+        , state(std::make_shared<PipeState>())
+    {
+        state->restartable = restartable;
+        // the thread owns the state, as it can be blocked in a read after the collection is gone
+        std::thread(read, state).detach();
+        std::lock_guard<std::mutex> _lock(pipesLock);
+        pipes.emplace_back(state);
+    }
+
+    ~PipeVideoImageCollection() override
+    {
+        std::lock_guard<std::mutex> _lock(state->mutex);
+        state->closed = true;
+        if (state->source)
+            state->source->interrupt();
+        state->cond.notify_all();
+    }
+
+    int getLength() const override
+    {
+        std::lock_guard<std::mutex> _lock(state->mutex);
+        return state->length;
+    }
+
+    std::shared_ptr<ImageProvider> getImageProvider(int index) const override
+    {
+        std::string key = getKey(index);
+        std::string filename = this->filename;
+        std::shared_ptr<PipeState> state = this->state;
+        auto provider = [filename, state, index]() {
+            return std::make_shared<PipeVideoImageProvider>(filename, index, state);
+        };
+        return getCacheImageProvider(key, provider);
+    }
+
+    // returns whether frames arrived since the last call
+    static bool pollPipes();
+};
+
+std::mutex PipeVideoImageCollection::pipesLock;
+std::vector<std::weak_ptr<PipeState>> PipeVideoImageCollection::pipes;
+
+// reads a stream of frames, 'open' starts it (again)
+static void readPipeStream(const std::string& name, const std::function<std::shared_ptr<PipeSource>()>& open,
+    const PipeLayout& initial, const std::shared_ptr<PipeState>& state)
+{
+    // frames of this run of the command which are not kept, when it was started again for an older frame
+    int skip = 0;
+    for (;;) {
+        std::shared_ptr<PipeSource> source = open();
+        {
+            std::lock_guard<std::mutex> _lock(state->mutex);
+            if (state->closed)
+                return;
+            state->source = source;
+        }
+
+        PipeLayout layout = initial;
+        int position = 0;
+        bool stopped = false;
+        while (!stopped) {
+            std::shared_ptr<const NumpyArray> array = readPipeArray(*source, layout, name);
+            if (!array)
+                break;
+            size_t frameBytes = sizeof(float) * array->w * array->h * array->d;
+            for (size_t i = 0; i < array->length && !stopped; i++, position++) {
+                if (layout.raw.frames && (size_t)position >= layout.raw.frames) {
+                    stopped = true;
+                    break;
+                }
+                std::unique_lock<std::mutex> lk(state->mutex);
+                PipeState& s = *state;
+                s.capacity = std::max<size_t>(2, gPipeBufferMB * 1000000 / std::max<size_t>(frameBytes, 1));
+                if (position >= skip) {
+                    // the oldest frame is only dropped once it is far enough behind the requested one
+                    s.cond.wait(lk, [&s]() {
+                        return s.closed || s.restart >= 0 || !s.restartable || s.frames.size() < s.capacity
+                            || (!s.requests.empty() && s.first + (int)s.capacity / 2 < *s.requests.rbegin());
+                    });
+                    if (s.closed || s.restart >= 0) {
+                        stopped = true;
+                        break;
+                    }
+                    if (s.frames.empty())
+                        s.first = position;
+                    s.frames.emplace_back(array, i);
+                    if (s.frames.size() > s.capacity) {
+                        s.frames.pop_front();
+                        s.first++;
+                    }
+                    s.length = std::max(s.length, position + 1);
+                    s.arrivals++;
+                    s.cond.notify_all();
+                }
+            }
+        }
+
+        std::unique_lock<std::mutex> lk(state->mutex);
+        PipeState& s = *state;
+        s.source = nullptr;
+        if (s.restart < 0) {
+            // the stream is over, until a frame which left the history is requested
+            s.ended = true;
+            s.arrivals++;
+            s.cond.notify_all();
+            s.cond.wait(lk, [&s]() { return s.closed || s.restart >= 0; });
+        }
+        if (s.closed)
+            return;
+        // some frames before the requested one are kept, for scrubbing back
+        skip = std::max(0, s.restart - (int)s.capacity / 2);
+        s.frames.clear();
+        s.first = skip;
+        s.restart = -1;
+        s.ended = false;
+        lk.unlock();
+        fprintf(stderr, "[cmd] starting '%s' again, for frame %d\n", name.c_str(), skip);
+    }
+}
+
+#ifndef WINDOWS
+// Ring of frames in a POSIX shared memory object (shm:<name>), written by a running program (see misc/vpv.py).
+// The fields are little-endian. The segment starts with a header of 64 bytes:
+//   0  char[8]  "VPVSHM1", written last by the producer
+//   8  u32      number of slots
+//   12 u32      non-zero once the producer replaced the segment by a new one of the same name
+//   16 u64      size of a slot, header included (a multiple of 64)
+//   24 u64      number of frames written, frame i is in the slot i % slots
+//   32 u32      incremented after each frame, and woken with FUTEX_WAKE on Linux
+// The slots follow it. Each one starts with a header of 64 bytes:
+//   0  u64      index of the frame, ~0 while it is written
+//   8  u32      height, width and number of channels
+//   20 char[8]  type of the samples, as given to raw: (u8, u16be, f32...)
+// followed by the samples, interleaved in C order (h, w, c).
+// The producer overwrites the oldest slot: the frames are copied out of their slot as soon as they are written,
+// and the copy is dropped if the index of the slot changed meanwhile. The copies are kept like those of stdin.
+static const size_t shmHeaderSize = 64;
+static const size_t shmSlotHeaderSize = 64;
+
+template <typename T>
+static T loadShm(const MappedFile& segment, size_t offset)
+{
+    return __atomic_load_n(reinterpret_cast<const T*>(segment.getData() + offset), __ATOMIC_ACQUIRE);
+}
+
+// nullptr if the segment does not exist (yet)
+static std::shared_ptr<MappedFile> openShmSegment(const std::string& name, bool* invalid)
+{
+    std::shared_ptr<MappedFile> segment = MappedFile::openSharedMemory(name);
+    if (!segment || segment->getSize() < shmHeaderSize)
+        return nullptr;
+    uint64_t magic;
+    memcpy(&magic, "VPVSHM1", 8);
+    if (loadShm<uint64_t>(*segment, 0) != magic)
+        return nullptr;
+    uint32_t slots = loadShm<uint32_t>(*segment, 8);
+    uint64_t slotSize = loadShm<uint64_t>(*segment, 16);
+    if (!slots || slotSize <= shmSlotHeaderSize || slotSize % 64
+        || (segment->getSize() - shmHeaderSize) / slotSize < slots) {
+        if (!*invalid)
+            fprintf(stderr, "[shm] '%s' is not a valid segment\n", name.c_str());
+        *invalid = true;
+        return nullptr;
+    }
+    return segment;
+}
+
+// a copy of the frame, nullptr if it is not (entirely) in its slot anymore
+static std::shared_ptr<const NumpyArray> readShmFrame(const std::shared_ptr<MappedFile>& segment,
+    const std::string& name, uint64_t frame)
+{
+    uint32_t slots = loadShm<uint32_t>(*segment, 8);
+    uint64_t slotSize = loadShm<uint64_t>(*segment, 16);
+    size_t offset = shmHeaderSize + frame % slots * slotSize;
+    if (loadShm<uint64_t>(*segment, offset) != frame)
+        return nullptr;
+    RawParameters raw;
+    raw.h = loadShm<uint32_t>(*segment, offset + 8);
+    raw.w = loadShm<uint32_t>(*segment, offset + 12);
+    raw.c = loadShm<uint32_t>(*segment, offset + 16);
+    raw.frames = 1;
+    char type[9] = {};
+    memcpy(type, segment->getData() + offset + 20, 8);
+    if (!parseSampleType(type, &raw.type, &raw.bigEndian) || raw.w <= 0 || raw.h <= 0 || raw.c <= 0
+        || (size_t)raw.w * raw.h * raw.c * getSampleSize(raw.type) > slotSize - shmSlotHeaderSize) {
+        if (loadShm<uint64_t>(*segment, offset) == frame)
+            fprintf(stderr, "[shm] invalid frame %lu in '%s'\n", (unsigned long)frame, name.c_str());
+        return nullptr;
+    }
+    std::vector<uint8_t> samples((size_t)raw.w * raw.h * raw.c * getSampleSize(raw.type));
+    if (!segment->read(offset + shmSlotHeaderSize, samples.size(), samples.data()))
+        return nullptr;
+    // the producer started to overwrite the slot during the copy
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (loadShm<uint64_t>(*segment, offset) != frame)
+        return nullptr;
+    raw.offset = 0;
+    return makeRawArray(MappedFile::fromBuffer(std::move(samples)), raw);
+}
+
+// waits for the next frame, or a bit
+static void waitShm(const MappedFile& segment, uint32_t notify)
+{
+#ifdef __linux__
+    struct timespec timeout = { 0, 100 * 1000000 };
+    syscall(SYS_futex, segment.getData() + 32, FUTEX_WAIT, notify, &timeout, nullptr, 0);
+#else
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+#endif
+}
+
+// follows the frames pushed in the segment, until the collection is closed
+static void readShmSegment(const std::string& name, const std::shared_ptr<PipeState>& state)
+{
+    // index in the sequence of the first frame of the current segment
+    int base = 0;
+    bool waiting = false;
+    bool invalid = false;
+    for (;;) {
+        std::shared_ptr<MappedFile> segment = openShmSegment(name, &invalid);
+        if (!segment) {
+            if (!waiting && !invalid)
+                fprintf(stderr, "[shm] waiting for the segment '%s'\n", name.c_str());
+            waiting = true;
+            std::unique_lock<std::mutex> lk(state->mutex);
+            if (state->cond.wait_for(lk, std::chrono::milliseconds(100), [&state]() { return state->closed; }))
+                return;
+            continue;
+        }
+        waiting = false;
+        invalid = false;
+
+        uint32_t slots = loadShm<uint32_t>(*segment, 8);
+        uint64_t seen = 0;
+        for (;;) {
+            uint32_t notify = loadShm<uint32_t>(*segment, 32);
+            uint64_t written = loadShm<uint64_t>(*segment, 24);
+            bool replaced = loadShm<uint32_t>(*segment, 12);
+            // the frames are copied before the lock is taken, the oldest ones may already be overwritten
+            std::vector<std::pair<int, std::shared_ptr<const NumpyArray>>> arrived;
+            for (uint64_t f = std::max(seen, written - std::min<uint64_t>(written, slots)); f < written; f++) {
+                if (std::shared_ptr<const NumpyArray> array = readShmFrame(segment, name, f))
+                    arrived.emplace_back(base + (int)f, array);
+            }
+            {
+                std::lock_guard<std::mutex> _lock(state->mutex);
+                PipeState& s = *state;
+                if (s.closed)
+                    return;
+                for (const auto& a : arrived) {
+                    int index = a.first;
+                    size_t frameBytes = sizeof(float) * a.second->w * a.second->h * a.second->d;
+                    s.capacity = std::max<size_t>(2, gPipeBufferMB * 1000000 / std::max<size_t>(frameBytes, 1));
+                    // the frames overwritten before they were copied leave holes in the history
+                    while (!s.frames.empty() && s.first + (int)s.frames.size() < index)
+                        s.frames.emplace_back(nullptr, 0);
+                    if (s.first + (int)s.frames.size() != index)
+                        s.frames.clear();
+                    if (s.frames.empty())
+                        s.first = index;
+                    s.frames.emplace_back(a.second, 0);
+                    while (s.frames.size() > s.capacity) {
+                        s.frames.pop_front();
+                        s.first++;
+                    }
+                    s.length = std::max(s.length, index + 1);
+                }
+                seen = std::max(seen, written);
+                s.arrivals++;
+                s.cond.notify_all();
+            }
+            if (replaced) {
+                // the frames of the new segment follow those of this one
+                base += seen;
+                break;
+            }
+            waitShm(*segment, notify);
+        }
+    }
+}
+#endif
+
+bool PipeVideoImageCollection::pollPipes()
+{
+    bool arrived = false;
+    bool changed = false;
+    bool follow = gTailJump;
+    {
+        std::lock_guard<std::mutex> _lock(pipesLock);
+        for (auto it = pipes.begin(); it != pipes.end();) {
+            if (std::shared_ptr<PipeState> state = it->lock()) {
+                std::lock_guard<std::mutex> _lock(state->mutex);
+                if (state->length != state->reported) {
+                    changed = true;
+                    follow |= !state->restartable;
+                }
+                state->reported = state->length;
+                arrived |= state->arrivals != state->notified;
+                state->notified = state->arrivals;
+                ++it;
+            } else {
+                it = pipes.erase(it);
+            }
+        }
+    }
+    if (changed) {
+        onLengthChange(follow);
+    }
+    return arrived;
+}
+
+bool pollGrowingCollections()
+{
+    // the pipes only need a lock
+    bool arrived = PipeVideoImageCollection::pollPipes();
+
+    // one stat per tailed file, a few times per second
+    static std::chrono::steady_clock::time_point last;
+    auto now = std::chrono::steady_clock::now();
+    if (!gTail || now - last < std::chrono::milliseconds(250))
+        return arrived;
+    last = now;
+    VPPVideoImageCollection::pollTailed();
+    return arrived;
+}
+
+// cmd:<command>, - (stdin), or raw:<parameters>: followed by one of them, or shm:<name>
+static bool isPipeExpression(const std::string& expression)
+{
+#ifndef WINDOWS
+    if (startswith(expression, "shm:"))
+        return true;
+#endif
+    std::string pipe = expression;
+    if (startswith(expression, "raw:")) {
+        size_t sep = expression.find(':', 4);
+        pipe = sep == std::string::npos ? "" : expression.substr(sep + 1);
+    }
+#ifndef WINDOWS
+    if (pipe == "-")
+        return true;
+#endif
+    return startswith(pipe, "cmd:");
+}
+
+static std::shared_ptr<ImageCollection> buildPipeCollection(const std::string& expression)
+{
+#ifndef WINDOWS
+    if (startswith(expression, "shm:")) {
+        std::string name = expression.substr(4);
+        auto read = [name](const std::shared_ptr<PipeState>& state) {
+            readShmSegment(name, state);
+        };
+        return std::make_shared<PipeVideoImageCollection>(expression, read, false);
+    }
+#endif
+    PipeLayout layout;
+    std::string pipe = expression;
+    if (startswith(expression, "raw:")) {
+        size_t sep = expression.find(':', 4);
+        pipe = expression.substr(sep + 1);
+        layout.known = parseRawParameters(expression.substr(4, sep - 4), &layout.raw);
+        if (!layout.known) {
+            // an empty sequence, the output can't be interpreted
+            return std::make_shared<RawVideoImageCollection>(expression, "", layout.raw);
+        }
+    }
+#ifndef WINDOWS
+    if (pipe == "-") {
+        layout.iio = true;
+        auto read = [expression, layout](const std::shared_ptr<PipeState>& state) {
+            readPipeStream(expression, []() { return std::make_shared<StdinPipeSource>(); }, layout, state);
+        };
+        return std::make_shared<PipeVideoImageCollection>(expression, read, false);
+    }
+#endif
+    std::string command = pipe.substr(4);
+    auto read = [expression, command, layout](const std::shared_ptr<PipeState>& state) {
+        readPipeStream(expression, [command]() { return std::make_shared<CommandPipeSource>(command); }, layout, state);
+    };
+    return std::make_shared<PipeVideoImageCollection>(expression, read, true);
+}
+
+static std::shared_ptr<ImageCollection> selectCollection(const fs::path& path)
+{
+    if (isPipeExpression(path.u8string())) {
+        return buildPipeCollection(path.u8string());
+    }
+    if (startswith(path.u8string(), "raw:")) {
+        return buildRawCollection(path.u8string());
+    }
+    if (fs::is_regular_file(path)) {
+        auto result = getFileTag(path);
+        if (result) {
+            auto tag = *result;
+            if (tag[0] == 'V' && tag[1] == 'P' && tag[2] == 'P' && tag[3] == 0) {
+                return std::make_shared<VPPVideoImageCollection>(path.u8string());
+            }
+            if (tag[0] == 'Y' && tag[1] == 'U' && tag[2] == 'V' && tag[3] == '4') {
+                return std::make_shared<Y4MVideoImageCollection>(path.u8string());
+            }
+#ifndef USE_GDAL // with gdal, pages are opened as subdatasets (see ",pages")
+            if (((tag[0] == 'M' && tag[1] == 'M') || (tag[0] == 'I' && tag[1] == 'I'))
+                && !RAWFileImageProvider::canOpen(path.u8string())) {
+                std::vector<uint64_t> offsets = indexTIFFPages(path.u8string());
+                if (offsets.size() > 1) {
+                    return std::make_shared<TIFFVideoImageCollection>(path.u8string(), offsets);
+                }
+            }
+#endif
+#ifdef USE_IIO_NPY
+            if (tag[0] == 0x93 && tag[1] == 'N' && tag[2] == 'U' && tag[3] == 'M') {
+                return std::make_shared<NumpyVideoImageCollection>(path.u8string());
+            }
+            if (tag[0] == 'P' && tag[1] == 'K' && tag[2] == 3 && tag[3] == 4 && path.extension() == ".npz") {
+                return std::make_shared<NpzVideoImageCollection>(path.u8string());
+            }
+#endif
+        }
+    }
+
+    return std::make_shared<SingleImageImageCollection>(path.u8string());
+}
+
+#ifdef USE_GDAL
+std::vector<fs::path> unpack_gdal_subdatasets(const std::string& filename)
+{
+    auto unpacked = std::vector<fs::path> {};
+
+    GDALDataset* g = (GDALDataset*)GDALOpen(filename.c_str(), GA_ReadOnly);
+    if (g == nullptr) {
+        return unpacked;
+    }
+
+    // example of SUBDATASETS:
+    // SUBDATASET_1_NAME=GTIFF_DIR:1:/tmp/t/multipage_tiff_example.tif
+    // SUBDATASET_1_DESC=Page 1 (800P x 600L x 3B)
+    // SUBDATASET_2_NAME=GTIFF_DIR:2:/tmp/t/multipage_tiff_example.tif
+    // SUBDATASET_2_DESC=Page 2 (800P x 600L x 3B)
+    char** subdatasets = g->GetMetadata("SUBDATASETS");
+
+    if (subdatasets != nullptr && *subdatasets != nullptr) {
+        for (int i = 0; subdatasets[i] != nullptr; i++) {
+            std::string metadata(subdatasets[i]);
+            if (metadata.find("_NAME=") != std::string::npos) {
+                size_t pos = metadata.find("=");
+                if (pos != std::string::npos) {
+                    std::string path = metadata.substr(pos + 1);
+                    unpacked.push_back(fs::path(path));
+                }
+            }
+        }
+    }
+
+    if (g != nullptr) {
+        GDALClose(g);
+    }
+
+    return unpacked;
+}
+#endif // USE_GDAL
 
 std::shared_ptr<ImageCollection> buildImageCollectionFromFilenames(const std::vector<fs::path>& paths_)
 {
@@ -415,6 +2821,14 @@ std::shared_ptr<ImageCollection> buildImageCollectionFromFilenames(const std::ve
         }
     }
     paths = expanded_paths;
+#else
+    // the pages of a tiff are always expanded
+    for (auto& path : paths) {
+        std::string pathstr = path.u8string();
+        if (endswith(pathstr, ",pages")) {
+            path = fs::path(pathstr.substr(0, pathstr.length() - 6));
+        }
+    }
 #endif // USE_GDAL
 
     if (paths.size() == 1) {
@@ -425,9 +2839,23 @@ std::shared_ptr<ImageCollection> buildImageCollectionFromFilenames(const std::ve
     // the reason is just that it would be slow to check the tag of each file
     std::shared_ptr<MultipleImageCollection> collection = std::make_shared<MultipleImageCollection>();
     for (auto& path : paths) {
+        if (isPipeExpression(path.u8string())) {
+            collection->append(buildPipeCollection(path.u8string()));
+            continue;
+        }
+        if (startswith(path.u8string(), "raw:")) {
+            collection->append(buildRawCollection(path.u8string()));
+            continue;
+        }
+        if (path.extension() == ".y4m") {
+            collection->append(std::make_shared<Y4MVideoImageCollection>(path.u8string()));
+            continue;
+        }
 #ifdef USE_IIO_NPY
         if (path.extension() == ".npy") { // TODO: this is ugly, but faster than checking the tag
             collection->append(std::make_shared<NumpyVideoImageCollection>(path.u8string()));
+        } else if (path.extension() == ".npz") {
+            collection->append(std::make_shared<NpzVideoImageCollection>(path.u8string()));
         } else {
 #else
         {
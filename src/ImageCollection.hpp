@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <memory>
 #include <string>
@@ -21,13 +22,28 @@ public:
     }
     virtual int getLength() const = 0;
     virtual std::shared_ptr<ImageProvider> getImageProvider(int index) const = 0;
+    // reduced version of a frame (1/reduction of its resolution), nullptr if the format can't provide it cheaply
+    virtual std::shared_ptr<ImageProvider> getPreviewProvider(int index, int reduction) const
+    {
+        return nullptr;
+    }
     virtual const std::string& getFilename(int index) const = 0;
+    // whether the frame is a whole file, which can be read ahead (the frames of a video share their file)
+    virtual bool isWholeFile(int index) const
+    {
+        return false;
+    }
     virtual std::string getKey(int index) const = 0;
     virtual void onFileReload(const std::string& filename) = 0;
 };
 
 std::shared_ptr<ImageCollection> buildImageCollectionFromFilenames(const std::vector<fs::path>& filenames);
 
+// checks whether the files which are still being written (e.g. VPP) have new frames, see TAIL
+// called by the main loop, the files are actually checked only a few times per second
+// returns whether frames arrived in the pipes, for the providers waiting for them (see Progressable::isWaiting)
+bool pollGrowingCollections();
+
 class MultipleImageCollection : public ImageCollection {
     std::vector<std::shared_ptr<ImageCollection>> collections;
     std::vector<int> lengths;
@@ -64,6 +80,18 @@ public:
         return collections[i]->getFilename(index);
     }
 
+    bool isWholeFile(int index) const override
+    {
+        if (index >= totalLength)
+            return false;
+        int i = 0;
+        while (index < totalLength && index >= lengths[i]) {
+            index -= lengths[i];
+            i++;
+        }
+        return collections[i]->isWholeFile(index);
+    }
+
     std::string getKey(int index) const override
     {
         int i = 0;
@@ -89,6 +117,16 @@ public:
         return collections[i]->getImageProvider(index);
     }
 
+    std::shared_ptr<ImageProvider> getPreviewProvider(int index, int reduction) const override
+    {
+        int i = 0;
+        while (index < totalLength && index >= lengths[i]) {
+            index -= lengths[i];
+            i++;
+        }
+        return collections[i]->getPreviewProvider(index, reduction);
+    }
+
     void onFileReload(const std::string& filename) override
     {
         for (const auto& c : collections) {
@@ -101,10 +139,13 @@ public:
 class SingleImageImageCollection : public ImageCollection {
     std::string filename;
     mutable std::string key;
+    // whether the file is a JPEG (which has previews), -1 until the file is checked
+    mutable std::atomic<int> jpeg;
 
 public:
     SingleImageImageCollection(const std::string& filename)
         : filename(filename)
+        , jpeg(-1)
     {
     }
 
@@ -115,6 +156,11 @@ public:
         return filename;
     }
 
+    bool isWholeFile(int index) const override
+    {
+        return true;
+    }
+
     std::string getKey(int index) const override
     {
         return "image:" + filename;
@@ -126,11 +172,13 @@ public:
     }
 
     std::shared_ptr<ImageProvider> getImageProvider(int index) const override;
+    std::shared_ptr<ImageProvider> getPreviewProvider(int index, int reduction) const override;
 
     void onFileReload(const std::string& fname) override
     {
         if (filename == fname) {
             //ImageCache::remove(filename);
+            jpeg = -1;
         }
     }
 };
@@ -153,6 +201,12 @@ public:
     }
 
     std::string getKey(int index) const override
+    {
+        return makeKey(filename, index);
+    }
+
+    // key of a frame, for the callbacks which outlive the collection
+    static std::string makeKey(const std::string& filename, int index)
     {
         return "video:" + filename + ":" + std::to_string(index);
     }
@@ -193,6 +247,11 @@ public:
         return collections[0]->getFilename(index);
     }
 
+    bool isWholeFile(int index) const override
+    {
+        return collections[0]->isWholeFile(index);
+    }
+
     std::string getKey(int index) const override
     {
         std::string key("edit:" + std::to_string(edittype) + editprog);
@@ -243,6 +302,13 @@ public:
         return parent->getFilename(index);
     }
 
+    bool isWholeFile(int index) const override
+    {
+        if (index >= masked)
+            index++;
+        return parent->isWholeFile(index);
+    }
+
     std::string getKey(int index) const override
     {
         if (index >= masked)
@@ -286,6 +352,11 @@ public:
         return parent->getFilename(index);
     }
 
+    bool isWholeFile(int) const override
+    {
+        return parent->isWholeFile(index);
+    }
+
     std::string getKey(int) const override
     {
         return parent->getKey(index);
@@ -326,6 +397,12 @@ public:
         return parent->getFilename(index);
     }
 
+    bool isWholeFile(int index) const override
+    {
+        index = std::max(0, index + offset);
+        return parent->isWholeFile(index);
+    }
+
     std::string getKey(int index) const override
     {
         index = std::max(0, index + offset);
@@ -1,5 +1,8 @@
+#include <atomic>
+#include <cctype>
 #include <cerrno>
 #include <memory>
+#include <mutex>
 
 #ifdef USE_IIO
 extern "C" {
@@ -9,8 +12,12 @@ extern "C" {
 
 #include "Image.hpp"
 #include "ImageProvider.hpp"
+#include "LoadingThread.hpp"
+#include "MappedFile.hpp"
 #include "editors.hpp"
 #include "fs.hpp"
+#include "globals.hpp"
+#include "pixelconv.hpp"
 
 #ifdef USE_IIO
 static std::shared_ptr<Image> load_from_iio(const std::string& filename)
@@ -88,11 +95,12 @@ extern "C" {
 
 class JPEGFileImageProvider::impl {
 public:
-    impl(JPEGFileImageProvider* provider)
+    impl(JPEGFileImageProvider* provider, int reduction)
         : cinfo()
+        , reduction(reduction)
         , file(nullptr)
-        , pixels(nullptr)
-        , scanline(nullptr)
+        , image(nullptr)
+        , scanlines(nullptr)
         , error(false)
         , jerr()
         , provider(provider)
@@ -107,9 +115,6 @@ public:
         if (file) {
             fclose(file);
         }
-        if (pixels) {
-            free(pixels);
-        }
         jpeg_abort((j_common_ptr)&cinfo);
     }
 
@@ -121,7 +126,7 @@ public:
 
     float getProgressPercentage() const
     {
-        if (pixels) {
+        if (image) {
             return (float)cinfo.output_scanline / cinfo.output_height;
         } else {
             return 0.f;
@@ -131,7 +136,7 @@ public:
     void progress()
     {
         assert(!error);
-        if (!pixels) {
+        if (!image) {
             file = fopen(provider->filename.c_str(), "rb");
             if (!file) {
                 provider->onFinish(makeError(strerror(errno)));
@@ -149,30 +154,52 @@ public:
             if (error)
                 return;
 
+            if (reduction > 1) {
+                cinfo.scale_num = 1;
+                cinfo.scale_denom = reduction;
+            }
+            // previews don't need an exact reconstruction either
+            if (gJPEGFastDecode || reduction > 1) {
+                cinfo.dct_method = JDCT_IFAST;
+                cinfo.do_fancy_upsampling = FALSE;
+            }
+
             jpeg_start_decompress(&cinfo);
             if (error)
                 return;
 
-            pixels = (float*)malloc(sizeof(float) * cinfo.output_width * cinfo.output_height * cinfo.output_components);
-            scanline = std::make_unique<unsigned char[]>(cinfo.output_width * cinfo.output_components);
-        } else if (cinfo.output_scanline < cinfo.output_height) {
-            JSAMPROW sample = scanline.get();
-            jpeg_read_scanlines(&cinfo, &sample, 1);
-            if (error)
-                return;
+            float* pixels = (float*)malloc(sizeof(float) * cinfo.output_width * cinfo.output_height * cinfo.output_components);
+            image = std::make_shared<Image>(pixels, cinfo.output_width, cinfo.output_height,
+                cinfo.output_components, 0.f, 255.f);
+            image->size = ImVec2(cinfo.image_width, cinfo.image_height);
+            provider->setProvisionalImage(image);
+            // libjpeg produces up to rec_outbuf_height rows at once
             size_t rowwidth = cinfo.output_width * cinfo.output_components;
-            for (size_t j = 0; j < rowwidth; j++) {
-                pixels[(size_t)(cinfo.output_scanline - 1) * rowwidth + j] = scanline[j];
+            scanlines = std::make_unique<unsigned char[]>(rowwidth * cinfo.rec_outbuf_height);
+            rows.resize(cinfo.rec_outbuf_height);
+            for (size_t i = 0; i < rows.size(); i++) {
+                rows[i] = scanlines.get() + i * rowwidth;
             }
+        } else if (cinfo.output_scanline < cinfo.output_height) {
+            ProgressBudget budget;
+            size_t rowwidth = cinfo.output_width * cinfo.output_components;
+            float* pixels = image->pixels;
+            do {
+                size_t first = cinfo.output_scanline;
+                JDIMENSION n = jpeg_read_scanlines(&cinfo, rows.data(), rows.size());
+                if (error)
+                    return;
+                convertU8ToFloat(scanlines.get(), pixels + first * rowwidth, n * rowwidth);
+            } while (cinfo.output_scanline < cinfo.output_height && !budget.exhausted());
+            image->setValidRows(cinfo.output_scanline);
         } else {
             jpeg_finish_decompress(&cinfo);
             if (error)
                 return;
 
-            std::shared_ptr<Image> image = std::make_shared<Image>(pixels,
-                cinfo.output_width, cinfo.output_height, cinfo.output_components);
+            image->complete();
             provider->onFinish(image);
-            pixels = nullptr;
+            image = nullptr;
         }
     }
 
@@ -186,17 +213,19 @@ private:
     }
 
     struct jpeg_decompress_struct cinfo;
+    int reduction;
     FILE* file;
-    float* pixels;
-    std::unique_ptr<unsigned char[]> scanline;
+    std::shared_ptr<Image> image;
+    std::unique_ptr<unsigned char[]> scanlines;
+    std::vector<JSAMPROW> rows;
     bool error;
     struct jpeg_error_mgr jerr;
     JPEGFileImageProvider* provider;
 };
 
-JPEGFileImageProvider::JPEGFileImageProvider(const std::string& filename)
+JPEGFileImageProvider::JPEGFileImageProvider(const std::string& filename, int reduction)
     : FileImageProvider(filename)
-    , pimpl(new impl(this))
+    , pimpl(new impl(this, reduction))
 {
 }
 
@@ -226,7 +255,9 @@ struct PNGPrivate {
     int channels;
     int depth;
     uint32_t cur;
-    float* pixels;
+    bool interlaced;
+    std::shared_ptr<Image> image;
+    // rows of interlaced images are built over several passes, in the native format
     std::unique_ptr<png_byte[]> pngframe;
 
     uint32_t length;
@@ -238,7 +269,8 @@ struct PNGPrivate {
         , png_ptr(nullptr)
         , info_ptr(nullptr)
         , height(0)
-        , pixels(nullptr)
+        , interlaced(false)
+        , image(nullptr)
         , pngframe(nullptr)
         , buffer(nullptr)
     {
@@ -249,9 +281,6 @@ struct PNGPrivate {
         if (png_ptr) {
             png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
         }
-        if (pixels) {
-            free(pixels);
-        }
     }
 
     void info_callback()
@@ -278,11 +307,13 @@ struct PNGPrivate {
             depth = 8;
         }
 
-        pixels = (float*)malloc(sizeof(float) * width * height * channels);
-        pngframe = std::make_unique<png_byte[]>(width * height * channels * depth / 8);
+        float* pixels = (float*)malloc(sizeof(float) * width * height * channels);
+        image = std::make_shared<Image>(pixels, width, height, channels, 0.f, depth == 16 ? 65535.f : 255.f);
 
-        if (png_get_interlace_type(png_ptr, info_ptr) != PNG_INTERLACE_NONE) {
+        interlaced = png_get_interlace_type(png_ptr, info_ptr) != PNG_INTERLACE_NONE;
+        if (interlaced) {
             png_set_interlace_handling(png_ptr);
+            pngframe = std::make_unique<png_byte[]>((size_t)width * height * channels * depth / 8);
         }
 
         png_start_read_image(png_ptr);
@@ -291,7 +322,14 @@ struct PNGPrivate {
     void row_callback(png_bytep new_row, png_uint_32 row_num, int pass)
     {
         if (new_row) {
-            png_progressive_combine_row(png_ptr, pngframe.get() + row_num * width * channels * depth / 8, new_row);
+            if (interlaced) {
+                png_progressive_combine_row(png_ptr, pngframe.get() + (size_t)row_num * width * channels * depth / 8, new_row);
+            } else {
+                // without interlacing, rows arrive once and in order,
+                // so they are converted straight into the image and can be shown right away
+                convert_row(new_row, row_num);
+                image->setValidRows(row_num + 1);
+            }
         }
         cur = row_num;
     }
@@ -300,30 +338,40 @@ struct PNGPrivate {
     {
     }
 
-    std::shared_ptr<Image> getImage()
+    void convert_row(const png_byte* src, uint32_t row)
     {
+        size_t rowwidth = (size_t)width * channels;
+        float* dst = image->pixels + row * rowwidth;
         switch (depth) {
         // depths 1, 2 and 4 are unpacked by libpng to 8bits
         case 8:
-            for (size_t i = 0; i < width * height * channels; i++) {
-                pixels[i] = pngframe[i];
-            }
+            convertU8ToFloat(src, dst, rowwidth);
             break;
         case 16:
-            for (size_t i = 0; i < width * height * channels; i++) {
-                png_byte* b = pngframe.get() + i * 2;
-                std::swap(b[0], b[1]);
-                uint16_t sample = *(uint16_t*)b;
-                pixels[i] = sample;
-            }
+            // samples are stored big-endian
+            convertU16BEToFloat(src, dst, rowwidth);
             break;
-        default:
+        }
+    }
+
+    std::shared_ptr<Image> getImage()
+    {
+        if (depth != 8 && depth != 16) {
             assert(0);
             return nullptr;
         }
 
-        auto img = std::make_shared<Image>(pixels, width, height, channels);
-        pixels = nullptr;
+        if (interlaced) {
+            size_t rowbytes = (size_t)width * channels * depth / 8;
+            for (uint32_t row = 0; row < height; row++) {
+                convert_row(pngframe.get() + row * rowbytes, row);
+            }
+            pngframe = nullptr;
+        }
+
+        image->complete();
+        auto img = image;
+        image = nullptr;
         return img;
     }
 };
@@ -407,21 +455,28 @@ void PNGFileImageProvider::progress()
             return;
         }
 
-        p->length = 1 << 12;
+        // large reads, the budget loop gives the thread back often enough
+        p->length = 1 << 18;
         p->buffer = std::make_unique<png_byte[]>(p->length);
         p->cur = 0;
     } else if (p->file && !p->file.eof()) {
-        p->file.read(reinterpret_cast<char*>(p->buffer.get()), p->length);
-        if (!p->file && !p->file.eof()) {
-            onFinish(makeError(strerror(errno)));
-            return;
-        }
-
         if (setjmp(png_jmpbuf(p->png_ptr))) {
             return;
         }
 
-        png_process_data(p->png_ptr, p->info_ptr, p->buffer.get(), p->file.gcount());
+        ProgressBudget budget;
+        do {
+            p->file.read(reinterpret_cast<char*>(p->buffer.get()), p->length);
+            if (!p->file && !p->file.eof()) {
+                onFinish(makeError(strerror(errno)));
+                return;
+            }
+
+            png_process_data(p->png_ptr, p->info_ptr, p->buffer.get(), p->file.gcount());
+        } while (p->file && !p->file.eof() && !budget.exhausted());
+        if (p->image && !p->interlaced) {
+            setProvisionalImage(p->image);
+        }
     } else if (p->cur != p->height - 1) {
         onFinish(makeError("truncated file?"));
     } else {
@@ -442,38 +497,261 @@ void PNGFileImageProvider::onPNGError(const std::string& error)
 
 #include <tiffio.h>
 
-struct TIFFPrivate {
-    TIFFFileImageProvider* provider;
-    TIFF* tif;
+// type of the samples of a TIFF file, false if they are not handled natively (e.g. 1, 4 or 12 bits)
+static bool getTIFFSampleType(uint16_t fmt, uint16_t bps, SampleType* type)
+{
+    switch (fmt) {
+    case SAMPLEFORMAT_UINT:
+    case SAMPLEFORMAT_VOID:
+        switch (bps) {
+        case 8:
+            *type = SampleType::U8;
+            return true;
+        case 16:
+            *type = SampleType::U16;
+            return true;
+        case 32:
+            *type = SampleType::U32;
+            return true;
+        case 64:
+            *type = SampleType::U64;
+            return true;
+        }
+        break;
+    case SAMPLEFORMAT_INT:
+        switch (bps) {
+        case 8:
+            *type = SampleType::I8;
+            return true;
+        case 16:
+            *type = SampleType::I16;
+            return true;
+        case 32:
+            *type = SampleType::I32;
+            return true;
+        case 64:
+            *type = SampleType::I64;
+            return true;
+        }
+        break;
+    case SAMPLEFORMAT_IEEEFP:
+        switch (bps) {
+        case 16:
+            *type = SampleType::F16;
+            return true;
+        case 32:
+            *type = SampleType::F32;
+            return true;
+        case 64:
+            *type = SampleType::F64;
+            return true;
+        }
+        break;
+    }
+    return false;
+}
+
+// Organization of the samples of a TIFF directory.
+// Strips are handled as tiles as wide as the image, blocks are numbered like libtiff does
+// (row-major, then plane by plane for separate planes).
+struct TIFFLayout {
+    std::string filename;
+    uint64_t directoryOffset;
     uint32_t w, h;
     uint16_t spp, bps, fmt;
-    float* data;
-    uint8_t* buf;
-    bool broken;
-    uint32_t curh;
-    int sls;
+    bool planar;
+    bool tiled;
+    uint32_t blockw, blockh;
+    uint32_t across, down;
+    uint32_t numBlocks;
+    SampleType type;
+
+    // returns false if the layout is not handled natively
+    bool read(TIFF* tif)
+    {
+        int r = 0;
+        r += TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &w);
+        r += TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &h);
+        if (r != 2 || !w || !h)
+            return false;
+
+        if (!TIFFGetField(tif, TIFFTAG_SAMPLESPERPIXEL, &spp))
+            spp = 1;
+        if (!TIFFGetField(tif, TIFFTAG_BITSPERSAMPLE, &bps))
+            bps = 1;
+        if (!TIFFGetField(tif, TIFFTAG_SAMPLEFORMAT, &fmt))
+            fmt = SAMPLEFORMAT_UINT;
+
+        // complex samples are shown as two channels
+        if (fmt == SAMPLEFORMAT_COMPLEXINT || fmt == SAMPLEFORMAT_COMPLEXIEEEFP) {
+            spp *= 2;
+            bps /= 2;
+            fmt = fmt == SAMPLEFORMAT_COMPLEXINT ? SAMPLEFORMAT_INT : SAMPLEFORMAT_IEEEFP;
+        }
 
-    TIFFPrivate(TIFFFileImageProvider* provider)
-        : provider(provider)
-        , tif(nullptr)
-        , h(0)
-        , data(nullptr)
-        , buf(nullptr)
-        , curh(0)
+        uint16_t planarity;
+        if (!TIFFGetField(tif, TIFFTAG_PLANARCONFIG, &planarity))
+            planarity = PLANARCONFIG_CONTIG;
+        planar = planarity == PLANARCONFIG_SEPARATE && spp > 1;
+
+        // palettes and subsampled chroma need the color conversions of libtiff (or of iio)
+        uint16_t photometric;
+        if (TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, &photometric)
+            && (photometric == PHOTOMETRIC_PALETTE || photometric == PHOTOMETRIC_YCBCR))
+            return false;
+
+        tiled = TIFFIsTiled(tif);
+        if (tiled) {
+            if (!TIFFGetField(tif, TIFFTAG_TILEWIDTH, &blockw) || !TIFFGetField(tif, TIFFTAG_TILELENGTH, &blockh))
+                return false;
+        } else {
+            uint32_t rowsperstrip;
+            TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &rowsperstrip);
+            blockw = w;
+            blockh = std::min(std::max(rowsperstrip, 1u), h);
+        }
+        if (!blockw || !blockh)
+            return false;
+        across = (w + blockw - 1) / blockw;
+        down = (h + blockh - 1) / blockh;
+        numBlocks = across * down * (planar ? spp : 1);
+        if (numBlocks != (tiled ? TIFFNumberOfTiles(tif) : TIFFNumberOfStrips(tif)))
+            return false;
+
+        return getTIFFSampleType(fmt, bps, &type);
+    }
+};
+
+// Blocks [first, last) of a TIFF directory, decoded with their own handle,
+// so that the bands of a large image can be decoded by the helper threads at once.
+class TIFFBand : public Progressable {
+    std::shared_ptr<const TIFFLayout> layout;
+    std::shared_ptr<Image> image;
+    uint32_t first, last;
+    std::atomic<uint32_t> next;
+    TIFF* tif;
+    std::vector<uint8_t> buffer;
+    std::string error;
+    mutable std::mutex mutex;
+    std::atomic<bool> loaded;
+
+    void finish(const std::string& e = "")
     {
+        error = e;
+        if (tif) {
+            TIFFClose(tif);
+            tif = nullptr;
+        }
+        buffer = std::vector<uint8_t>();
+        loaded = true;
     }
 
-    ~TIFFPrivate()
+    bool readBlock(uint32_t b)
     {
-        if (buf) {
-            _TIFFfree(buf);
+        const TIFFLayout& l = *layout;
+        uint32_t perPlane = l.across * l.down;
+        uint32_t plane = b / perPlane;
+        uint32_t x0 = (b % perPlane % l.across) * l.blockw;
+        uint32_t y0 = (b % perPlane / l.across) * l.blockh;
+        uint32_t bw = std::min(l.blockw, l.w - x0);
+        uint32_t bh = std::min(l.blockh, l.h - y0);
+
+        // contiguous float strips are already in the final format
+        if (!l.tiled && !l.planar && l.fmt == SAMPLEFORMAT_IEEEFP && l.bps == 32) {
+            float* dst = image->pixels + (size_t)y0 * l.w * l.spp;
+            return TIFFReadEncodedStrip(tif, b, dst, (tmsize_t)bh * l.w * l.spp * sizeof(float)) >= 0;
+        }
+
+        tmsize_t r = l.tiled ? TIFFReadEncodedTile(tif, b, buffer.data(), buffer.size())
+                             : TIFFReadEncodedStrip(tif, b, buffer.data(), buffer.size());
+        if (r < 0)
+            return false;
+        size_t nsamples = l.planar ? 1 : l.spp;
+        size_t srcstride = (size_t)l.blockw * nsamples * l.bps / 8;
+        for (uint32_t y = 0; y < bh; y++) {
+            float* dst = image->pixels + ((size_t)(y0 + y) * l.w + x0) * l.spp + plane;
+            // libtiff gives the samples in the byte order of the host
+            convertSamplesToFloat(l.type, false, buffer.data() + y * srcstride, 1, dst, l.planar ? l.spp : 1,
+                bw * nsamples);
         }
+        return true;
+    }
+
+public:
+    TIFFBand(const std::shared_ptr<const TIFFLayout>& layout, const std::shared_ptr<Image>& image,
+        uint32_t first, uint32_t last)
+        : layout(layout)
+        , image(image)
+        , first(first)
+        , last(last)
+        , next(first)
+        , tif(nullptr)
+        , loaded(false)
+    {
+    }
+
+    ~TIFFBand() override
+    {
         if (tif) {
             TIFFClose(tif);
         }
-        if (data)
-            free(data);
     }
+
+    float getProgressPercentage() const override
+    {
+        return (float)(next - first) / (last - first);
+    }
+
+    bool isLoaded() const override
+    {
+        return loaded;
+    }
+
+    // rows of the image decoded by this band and the previous ones (contiguous layouts only)
+    uint32_t getValidRows() const
+    {
+        return std::min(layout->h, next / layout->across * layout->blockh);
+    }
+
+    std::string getError() const
+    {
+        std::lock_guard<std::mutex> _lock(mutex);
+        return error;
+    }
+
+    void progress() override
+    {
+        // the band can be progressed by a helper thread and by the provider at the same time
+        std::lock_guard<std::mutex> _lock(mutex);
+        if (loaded)
+            return;
+        if (!tif) {
+            tif = TIFFOpen(layout->filename.c_str(), "rm");
+            if (!tif || (layout->directoryOffset && !TIFFSetSubDirectory(tif, layout->directoryOffset))) {
+                finish("cannot read tiff " + layout->filename);
+                return;
+            }
+            buffer.resize(layout->tiled ? TIFFTileSize(tif) : TIFFStripSize(tif));
+        }
+
+        ProgressBudget budget;
+        do {
+            if (!readBlock(next)) {
+                finish("error reading tiff block " + std::to_string(next));
+                return;
+            }
+            next++;
+        } while (next < last && !budget.exhausted());
+        if (next == last) {
+            finish();
+        }
+    }
+};
+
+struct TIFFPrivate {
+    std::shared_ptr<TIFFLayout> layout;
+    std::shared_ptr<Image> image;
+    std::vector<std::shared_ptr<TIFFBand>> bands;
 };
 
 TIFFFileImageProvider::~TIFFFileImageProvider()
@@ -485,67 +763,36 @@ TIFFFileImageProvider::~TIFFFileImageProvider()
 
 float TIFFFileImageProvider::getProgressPercentage() const
 {
-    if (p && p->h)
-        return (float)p->curh / p->h;
-    return 0.f;
+    if (!p || p->bands.empty())
+        return 0.f;
+    float percent = 0.f;
+    for (const auto& band : p->bands) {
+        percent += band->getProgressPercentage();
+    }
+    return percent / p->bands.size();
 }
 
 void TIFFFileImageProvider::progress()
 {
     if (!p) {
-        p = new TIFFPrivate(this);
-        p->tif = TIFFOpen(filename.c_str(), "rm");
-        if (!p->tif)
+        p = new TIFFPrivate;
+        TIFF* tif = TIFFOpen(filename.c_str(), "rm");
+        if (!tif || (directoryOffset && !TIFFSetSubDirectory(tif, directoryOffset))) {
+            if (tif)
+                TIFFClose(tif);
             return onFinish(makeError("cannot read tiff " + filename));
-
-        int r = 0;
-        r += TIFFGetField(p->tif, TIFFTAG_IMAGEWIDTH, &p->w);
-        r += TIFFGetField(p->tif, TIFFTAG_IMAGELENGTH, &p->h);
-
-        if (r != 2)
-            return onFinish(makeError("can not read tiff of unknown size"));
-
-        r = TIFFGetField(p->tif, TIFFTAG_SAMPLESPERPIXEL, &p->spp);
-        if (!r)
-            p->spp = 1;
-
-        r = TIFFGetField(p->tif, TIFFTAG_BITSPERSAMPLE, &p->bps);
-        if (!r)
-            p->bps = 1;
-
-        r = TIFFGetField(p->tif, TIFFTAG_SAMPLEFORMAT, &p->fmt);
-        if (!r)
-            p->fmt = SAMPLEFORMAT_UINT;
-
-        if (p->fmt == SAMPLEFORMAT_COMPLEXINT || p->fmt == SAMPLEFORMAT_COMPLEXIEEEFP) {
-            p->spp *= 2;
-            p->bps /= 2;
         }
-        if (p->fmt == SAMPLEFORMAT_COMPLEXINT)
-            p->fmt = SAMPLEFORMAT_INT;
-        if (p->fmt == SAMPLEFORMAT_COMPLEXIEEEFP)
-            p->fmt = SAMPLEFORMAT_IEEEFP;
-
-        uint16_t planarity;
-        r = TIFFGetField(p->tif, TIFFTAG_PLANARCONFIG, &planarity);
-        if (r != 1)
-            planarity = PLANARCONFIG_CONTIG;
-        p->broken = planarity == PLANARCONFIG_SEPARATE;
-
-        uint32_t scanline_size = (p->w * p->spp * p->bps) / 8;
-        int rbps = (p->bps / 8) ? (p->bps / 8) : 1;
-        p->sls = TIFFScanlineSize(p->tif);
-        if ((int)scanline_size != p->sls)
-            fprintf(stderr, "scanline_size,sls = %d,%d\n", (int)scanline_size, p->sls);
-        //assert((int)scanline_size == sls);
-        if (!p->broken)
-            assert((int)scanline_size == p->sls);
-        assert((int)scanline_size >= p->sls);
-        p->data = (float*)malloc(p->w * p->h * p->spp * rbps);
-        p->buf = (uint8_t*)_TIFFmalloc(scanline_size);
-        p->curh = 0;
-
-        if (TIFFIsTiled(p->tif) || p->fmt != SAMPLEFORMAT_IEEEFP || p->broken || rbps != sizeof(float)) {
+        p->layout = std::make_shared<TIFFLayout>();
+        p->layout->filename = filename;
+        p->layout->directoryOffset = directoryOffset;
+        bool native = p->layout->read(tif);
+        TIFFClose(tif);
+
+        // iio only reads the first page
+        if (!native && directoryOffset) {
+            return onFinish(makeError("unsupported tiff layout in page of " + filename));
+        }
+        if (!native) {
 #ifdef USE_IIO
             std::shared_ptr<Image> image = load_from_iio(filename);
             if (!image) {
@@ -556,19 +803,63 @@ void TIFFFileImageProvider::progress()
 #else
             onFinish(makeError("cannot load image '" + filename + "'"));
 #endif
+            return;
         }
-    } else if (p->curh < p->h) {
-        int r = TIFFReadScanline(p->tif, p->buf, p->curh);
-        if (r < 0) {
-            onFinish(makeError("error reading tiff row " + std::to_string(p->curh)));
+
+        const TIFFLayout& l = *p->layout;
+        float* data = (float*)malloc(sizeof(float) * l.w * l.h * l.spp);
+        float max = l.fmt == SAMPLEFORMAT_IEEEFP ? 1.f : (1u << std::min<int>(l.bps, 16)) - 1.f;
+        p->image = std::make_shared<Image>(data, l.w, l.h, l.spp, 0.f, max);
+        // separate planes are not filled row by row
+        if (!l.planar) {
+            setProvisionalImage(p->image);
+        }
+
+        // large images are split in bands of whole rows of blocks, decoded in parallel
+        uint32_t rowsOfBlocks = l.numBlocks / l.across;
+        size_t numBands = 1;
+        if ((size_t)l.w * l.h * l.spp >= (1 << 20)) {
+            numBands = std::min<size_t>(gLoadingHelpers.size() + 1, rowsOfBlocks);
+        }
+        for (size_t i = 0; i < numBands; i++) {
+            uint32_t first = rowsOfBlocks * i / numBands * l.across;
+            uint32_t last = rowsOfBlocks * (i + 1) / numBands * l.across;
+            p->bands.push_back(std::make_shared<TIFFBand>(p->layout, p->image, first, last));
+        }
+        if (numBands > 1) {
+            for (const auto& band : p->bands) {
+                pushLoadingTask(band);
+            }
+        }
+        return;
+    }
+
+    for (const auto& band : p->bands) {
+        if (!band->isLoaded()) {
+            // help decoding the first band which is not ready (or wait for the helper decoding it)
+            band->progress();
+            if (!p->layout->planar) {
+                uint32_t rows = 0;
+                for (const auto& b : p->bands) {
+                    rows = b->getValidRows();
+                    if (!b->isLoaded())
+                        break;
+                }
+                p->image->setValidRows(rows);
+            }
+            return;
         }
-        memcpy(p->data + p->curh * p->sls / sizeof(float), p->buf, p->sls);
-        p->curh++;
-    } else {
-        std::shared_ptr<Image> image = std::make_shared<Image>(p->data, p->w, p->h, p->spp);
-        onFinish(image);
-        p->data = nullptr;
     }
+
+    for (const auto& band : p->bands) {
+        std::string error = band->getError();
+        if (!error.empty()) {
+            return onFinish(makeError(error));
+        }
+    }
+    p->image->complete();
+    onFinish(p->image);
+    p->image = nullptr;
 }
 
 #ifdef USE_LIBRAW
@@ -635,10 +926,149 @@ end:
 #endif
 }
 
+struct PFMPrivate {
+    std::shared_ptr<MappedFile> file;
+    // of the samples, stored from the bottom row to the top one
+    size_t offset;
+    bool bigEndian;
+    std::shared_ptr<Image> image;
+    int curh;
+};
+
+PFMFileImageProvider::~PFMFileImageProvider()
+{
+    if (p) {
+        delete p;
+    }
+}
+
+float PFMFileImageProvider::getProgressPercentage() const
+{
+    return p && p->image ? (float)p->curh / p->image->h : 0.f;
+}
+
+// "PF" (color) or "Pf" (grayscale), the size and the scale, whose sign gives the endianness
+static bool parsePFMHeader(const MappedFile& file, int* w, int* h, int* d, bool* bigEndian, size_t* offset)
+{
+    const char* data = reinterpret_cast<const char*>(file.getData());
+    size_t size = file.getSize();
+    if (size < 3 || data[0] != 'P' || (data[1] != 'F' && data[1] != 'f'))
+        return false;
+    *d = data[1] == 'F' ? 3 : 1;
+
+    // the header is text, copied so that it can be parsed with sscanf
+    std::string header(data + 2, std::min<size_t>(size - 2, 256));
+    float scale;
+    int length;
+    if (sscanf(header.c_str(), "%d %d %f%n", w, h, &scale, &length) != 3 || *w <= 0 || *h <= 0
+        || (size_t)length >= header.size() || !isspace(header[length]))
+        return false;
+    *bigEndian = scale > 0;
+    // a single whitespace ends the header
+    *offset = 2 + length + 1;
+    return size - *offset >= (size_t)*w * *h * *d * sizeof(float);
+}
+
+void PFMFileImageProvider::progress()
+{
+    if (!p) {
+        p = new PFMPrivate;
+        std::shared_ptr<MappedFile> file = MappedFile::open(filename);
+        if (!file) {
+            return onFinish(makeError("cannot open pfm " + filename));
+        }
+        int w, h, d;
+        if (!parsePFMHeader(*file, &w, &h, &d, &p->bigEndian, &p->offset)) {
+            return onFinish(makeError("invalid pfm " + filename));
+        }
+        p->file = file;
+        float* pixels = (float*)malloc(sizeof(float) * w * h * d);
+        p->image = std::make_shared<Image>(pixels, w, h, d, 0.f, 1.f);
+        p->curh = 0;
+        setProvisionalImage(p->image);
+        return;
+    }
+
+    Image& image = *p->image;
+    size_t rowlength = image.w * image.c;
+    if (p->curh < (int)image.h) {
+        ProgressBudget budget;
+        do {
+            // each row is read to its place in the image (the rows are stored from the bottom to the top)
+            // and swapped there if needed
+            size_t rowbytes = rowlength * sizeof(float);
+            float* dst = image.pixels + p->curh * rowlength;
+            if (!p->file->read(p->offset + (image.h - 1 - p->curh) * rowbytes, rowbytes, dst)) {
+                p->image = nullptr;
+                p->file = nullptr;
+                return onFinish(makeError("cannot read pfm " + filename));
+            }
+            if (p->bigEndian) {
+                convertF32BEToFloat(reinterpret_cast<const uint8_t*>(dst), dst, rowlength);
+            }
+            p->curh++;
+        } while (p->curh < (int)image.h && !budget.exhausted());
+        image.setValidRows(p->curh);
+    } else {
+        image.complete();
+        onFinish(p->image);
+        p->image = nullptr;
+        p->file = nullptr;
+    }
+}
+
+void FLOFileImageProvider::progress()
+{
+    std::shared_ptr<MappedFile> file = MappedFile::open(filename);
+    if (!file) {
+        return onFinish(makeError("cannot open flo " + filename));
+    }
+    // "PIEH" (202021.25 as a float), width and height, then the (u, v) of each pixel, little-endian
+    const size_t header = 12;
+    int32_t w, h;
+    if (file->getSize() < header || memcmp(file->getData(), "PIEH", 4)) {
+        return onFinish(makeError("invalid flo " + filename));
+    }
+    memcpy(&w, file->getData() + 4, sizeof(w));
+    memcpy(&h, file->getData() + 8, sizeof(h));
+    size_t size = (size_t)w * h * 2 * sizeof(float);
+    if (w <= 0 || h <= 0 || file->getSize() - header < size) {
+        return onFinish(makeError("invalid flo " + filename));
+    }
+
+    float* pixels = (float*)malloc(size);
+    if (!file->read(header, size, pixels)) {
+        free(pixels);
+        return onFinish(makeError("cannot read flo " + filename));
+    }
+    onFinish(std::make_shared<Image>(pixels, w, h, 2));
+}
+
+bool EditedImageProvider::isWaiting() const
+{
+    // progress() only advances the first input which is not ready
+    for (const auto& p : providers) {
+        if (!p->isLoaded()) {
+            return p->isWaiting();
+        }
+    }
+    return false;
+}
+
 void EditedImageProvider::progress()
 {
+    if (!dispatched) {
+        // the inputs are independent, let the helper threads load them in parallel
+        for (const auto& p : providers) {
+            if (!p->isLoaded()) {
+                pushLoadingTask(p);
+            }
+        }
+        dispatched = true;
+    }
     for (const auto& p : providers) {
         if (!p->isLoaded()) {
+            // help loading the first input which is not ready (or wait for the helper loading it)
             p->progress();
             return;
         }
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
 #include <thread>
 
 #include <cassert>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
@@ -21,14 +24,22 @@ public:
     using Result = nonstd::expected<std::shared_ptr<Image>, std::string>;
 
 private:
-    bool loaded;
+    std::atomic<bool> loaded;
     Result result;
+    std::shared_ptr<Image> provisional;
 
 protected:
     void onFinish(const Result& res)
     {
         this->result = res;
-        loaded = true;
+        loaded.store(true, std::memory_order_release);
+        std::atomic_store(&provisional, std::shared_ptr<Image>());
+    }
+
+    // decoders that fill their output row by row can expose it while it is being loaded
+    void setProvisionalImage(const std::shared_ptr<Image>& image)
+    {
+        std::atomic_store(&provisional, image);
     }
 
     static Result makeError(typename Result::error_type e)
@@ -54,7 +65,13 @@ public:
 
     bool isLoaded() const override
     {
-        return loaded;
+        return loaded.load(std::memory_order_acquire);
+    }
+
+    // image being decoded, only its first getValidRows() rows can be displayed
+    virtual std::shared_ptr<Image> getProvisionalImage() const
+    {
+        return std::atomic_load(&provisional);
     }
 };
 
@@ -62,19 +79,26 @@ public:
 class CacheImageProvider : public ImageProvider {
     std::string key;
     std::function<std::shared_ptr<ImageProvider>()> get;
+    // read without the mutex by the UI thread (progress and provisional image), hence atomic_load/atomic_store
     std::shared_ptr<ImageProvider> provider;
+    // the same provider can be shared by several loaders (e.g. a displayed frame also used by an edit)
+    std::mutex mutex;
+    // false: the image will only be held by its users (see FrameStream), errors are still cached
+    bool caching;
 
 public:
-    CacheImageProvider(const std::string& key, const std::function<std::shared_ptr<ImageProvider>()>& get)
+    CacheImageProvider(const std::string& key, const std::function<std::shared_ptr<ImageProvider>()>& get,
+        bool caching = true)
         : key(key)
         , get(get)
+        , caching(caching)
     {
         if (ImageCache::has(key)) {
             onFinish(ImageCache::get(key));
         } else if (ImageCache::Error::has(key)) {
             onFinish(makeError(ImageCache::Error::get(key)));
         } else {
-            provider = get();
+            std::atomic_store(&provider, get());
         }
     }
 
@@ -85,11 +109,41 @@ public:
         if (ImageCache::has(key)) {
             return 1.f;
         }
-        return provider->getProgressPercentage();
+        std::shared_ptr<ImageProvider> provider = std::atomic_load(&this->provider);
+        return provider ? provider->getProgressPercentage() : 0.f;
+    }
+
+    // a provider of the same frame which does not store its image in the cache,
+    // this one can be shared with other loaders (see getCacheImageProvider)
+    std::shared_ptr<CacheImageProvider> makeUncached() const
+    {
+        return std::make_shared<CacheImageProvider>(key, get, false);
+    }
+
+    std::shared_ptr<Image> getProvisionalImage() const override
+    {
+        std::shared_ptr<ImageProvider> provider = std::atomic_load(&this->provider);
+        if (!provider) {
+            return nullptr;
+        }
+        return provider->getProvisionalImage();
+    }
+
+    bool isWaiting() const override
+    {
+        if (isLoaded() || ImageCache::has(key)) {
+            return false;
+        }
+        std::shared_ptr<ImageProvider> provider = std::atomic_load(&this->provider);
+        return provider && provider->isWaiting();
     }
 
     void progress() override
     {
+        std::lock_guard<std::mutex> _lock(mutex);
+        if (isLoaded()) {
+            return;
+        }
         if (ImageCache::has(key)) {
             onFinish(Result(ImageCache::get(key)));
             //printf("/!\\ inconsistent image loading\n");
@@ -99,7 +153,9 @@ public:
                 Result result = provider->getResult();
                 if (result.has_value()) {
                     std::shared_ptr<Image> image = result.value();
-                    ImageCache::store(key, image);
+                    if (caching) {
+                        ImageCache::store(key, image);
+                    }
                 } else {
                     ImageCache::Error::store(key, result.error());
                 }
@@ -165,7 +221,8 @@ private:
     std::unique_ptr<impl> pimpl;
 
 public:
-    JPEGFileImageProvider(const std::string& filename);
+    // with a reduction of 2, 4 or 8, the DCT scaling of libjpeg decodes a preview of the image
+    JPEGFileImageProvider(const std::string& filename, int reduction = 1);
 
     ~JPEGFileImageProvider() override;
 
@@ -197,11 +254,14 @@ public:
 
 class TIFFFileImageProvider : public FileImageProvider {
     struct TIFFPrivate* p;
+    // offset of the directory (page) to read, 0 for the first one
+    uint64_t directoryOffset;
 
 public:
-    TIFFFileImageProvider(const std::string& filename)
+    TIFFFileImageProvider(const std::string& filename, uint64_t directoryOffset = 0)
         : FileImageProvider(filename)
         , p(nullptr)
+        , directoryOffset(directoryOffset)
     {
     }
 
@@ -212,6 +272,42 @@ public:
     void progress() override;
 };
 
+// Portable float map (.pfm), read row by row into the image
+class PFMFileImageProvider : public FileImageProvider {
+    struct PFMPrivate* p;
+
+public:
+    PFMFileImageProvider(const std::string& filename)
+        : FileImageProvider(filename)
+        , p(nullptr)
+    {
+    }
+
+    ~PFMFileImageProvider() override;
+
+    float getProgressPercentage() const override;
+
+    void progress() override;
+};
+
+// Middlebury optical flow (.flo), whose two channels are displayed straight from a mapping of the file
+class FLOFileImageProvider : public FileImageProvider {
+public:
+    FLOFileImageProvider(const std::string& filename)
+        : FileImageProvider(filename)
+    {
+    }
+
+    ~FLOFileImageProvider() override = default;
+
+    float getProgressPercentage() const override
+    {
+        return 0.f;
+    }
+
+    void progress() override;
+};
+
 class RAWFileImageProvider : public FileImageProvider {
 
 public:
@@ -235,6 +331,7 @@ class EditedImageProvider : public ImageProvider {
     std::string editprog;
     std::vector<std::shared_ptr<ImageProvider>> providers;
     std::string key; // used for usedBy
+    bool dispatched;
 
 public:
     EditedImageProvider(EditType edittype, const std::string& editprog,
@@ -244,6 +341,7 @@ public:
         , editprog(editprog)
         , providers(providers)
         , key(key)
+        , dispatched(false)
     {
     }
 
@@ -262,6 +360,8 @@ public:
         return percent;
     }
 
+    bool isWaiting() const override;
+
     void progress() override;
 };
 
@@ -1,9 +1,48 @@
+#include <deque>
+
 #include "Progressable.hpp"
-#include "events.hpp"
 #include "globals.hpp"
 
 #include "LoadingThread.hpp"
 
+static std::mutex tasksLock;
+static std::deque<std::weak_ptr<Progressable>> tasks;
+
+void pushLoadingTask(const std::shared_ptr<Progressable>& task)
+{
+    // the helpers are forgotten at exit under this lock (see stopLoadingHelpers)
+    std::lock_guard<std::mutex> _lock(tasksLock);
+    if (gLoadingHelpers.empty())
+        return;
+    tasks.push_back(task);
+    for (auto helper : gLoadingHelpers) {
+        helper->notify();
+    }
+}
+
+std::shared_ptr<Progressable> popLoadingTask()
+{
+    std::lock_guard<std::mutex> _lock(tasksLock);
+    while (!tasks.empty()) {
+        std::shared_ptr<Progressable> task = tasks.front().lock();
+        tasks.pop_front();
+        if (canProgress(task)) {
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void stopLoadingHelpers()
+{
+    std::lock_guard<std::mutex> _lock(tasksLock);
+    for (auto helper : gLoadingHelpers) {
+        helper->stop();
+    }
+    gLoadingHelpers.clear();
+    tasks.clear();
+}
+
 bool LoadingThread::tick()
 {
     // load the queue
@@ -15,7 +54,7 @@ bool LoadingThread::tick()
         if (p.use_count() != 2) {
             gActive = std::max(gActive, 2);
         }
-        if (p->isLoaded()) {
+        if (p->isLoaded() || p->isWaiting()) {
             queue.pop();
         }
     }
@@ -38,7 +77,10 @@ void LoadingThread::run()
     while (running) {
         bool canrest = tick();
         if (canrest) {
-            stopTime(10);
+            std::unique_lock<std::mutex> lk(mutex);
+            cv.wait(lk, [this] { return ready; });
+            ready = false;
+            wakeups++;
         }
     }
 }
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <thread>
 
@@ -12,6 +15,10 @@ class LoadingThread {
     std::thread thread;
     std::queue<std::shared_ptr<Progressable>> queue;
     std::function<std::shared_ptr<Progressable>()> getnew;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool ready;
+    std::atomic<size_t> wakeups;
 
     bool tick();
 
@@ -21,6 +28,8 @@ public:
     LoadingThread(std::function<std::shared_ptr<Progressable>()> getnew)
         : running(false)
         , getnew(getnew)
+        , ready(false)
+        , wakeups(0)
     {
     }
 
@@ -33,16 +42,40 @@ public:
     void stop()
     {
         running = false;
+        notify();
     }
 
     void join()
     {
-        thread.join();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    // wake up the thread if it is resting, so that it asks for new work
+    void notify()
+    {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            ready = true;
+        }
+        cv.notify_one();
+    }
+
+    // number of times the thread left its resting state
+    size_t getWakeups() const
+    {
+        return wakeups;
     }
 };
 
-#include <condition_variable>
-#include <mutex>
+// Independent tasks (e.g. the inputs of an edit) that the helper threads (gLoadingHelpers) load in parallel.
+// Tasks are not kept alive by the queue, nor loaded twice if they are already loaded.
+void pushLoadingTask(const std::shared_ptr<Progressable>& task);
+std::shared_ptr<Progressable> popLoadingTask();
+// at exit, before the helper threads are destroyed: stops them and forgets them,
+// so that the tasks pushed by the other threads in the meantime are not given to them
+void stopLoadingHelpers();
 
 #include "globals.hpp"
 
@@ -65,7 +98,8 @@ class SleepyLoadingThread {
             if (current.use_count() != 1) {
                 gActive = std::max(gActive, 2);
             }
-            if (current->isLoaded()) {
+            // a waiting provider is picked again by getnew once the main loop notifies its data
+            if (current->isLoaded() || current->isWaiting()) {
                 current = nullptr;
             }
         }
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#ifndef WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.hpp"
+#include "fs.hpp"
+
+MappedFile::MappedFile()
+    : data(nullptr)
+    , size(0)
+    , mapped(false)
+    , fd(-1)
+{
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef WINDOWS
+    if (mapped) {
+        munmap(const_cast<uint8_t*>(data), size);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+}
+
+bool MappedFile::map(int fd, bool keep)
+{
+#ifndef WINDOWS
+    struct stat s;
+    if (fstat(fd, &s) || !S_ISREG(s.st_mode)) {
+        close(fd);
+        return false;
+    }
+    // an empty file has nothing to map, but it can still grow
+    if (s.st_size > 0) {
+        void* data = mmap(nullptr, s.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        this->data = static_cast<const uint8_t*>(data);
+        size = s.st_size;
+        mapped = true;
+    }
+    // the mapping stays valid after the descriptor is closed
+    if (keep) {
+        this->fd = fd;
+    } else {
+        close(fd);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& filename)
+{
+    std::shared_ptr<MappedFile> file(new MappedFile);
+#ifndef WINDOWS
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0 || !file->map(fd, true))
+        return nullptr;
+#else
+    fs::ifstream ifs(fs::path(filename), fs::ifstream::in | fs::ifstream::binary);
+    if (!ifs)
+        return nullptr;
+    file->buffer.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    file->data = file->buffer.data();
+    file->size = file->buffer.size();
+#endif
+    return file;
+}
+
+std::shared_ptr<MappedFile> MappedFile::openSharedMemory(const std::string& name)
+{
+#ifndef WINDOWS
+    std::shared_ptr<MappedFile> file(new MappedFile);
+    int fd = shm_open(("/" + name).c_str(), O_RDONLY, 0);
+    if (fd < 0 || !file->map(fd, false))
+        return nullptr;
+    return file;
+#else
+    return nullptr;
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::fromBuffer(std::vector<uint8_t>&& buffer)
+{
+    std::shared_ptr<MappedFile> file(new MappedFile);
+    file->buffer = std::move(buffer);
+    file->data = file->buffer.data();
+    file->size = file->buffer.size();
+    return file;
+}
+
+bool MappedFile::read(size_t offset, size_t length, void* out) const
+{
+#ifndef WINDOWS
+    if (fd >= 0) {
+        size_t done = 0;
+        while (done < length) {
+            ssize_t n = pread(fd, static_cast<uint8_t*>(out) + done, length - done, offset + done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            done += n;
+        }
+        return done == length;
+    }
+#endif
+    if (offset > size || length > size - offset)
+        return false;
+    memcpy(out, data + offset, length);
+    return true;
+}
+
+bool MappedFile::holds(size_t offset, size_t length) const
+{
+    if (offset > size || length > size - offset)
+        return false;
+#ifndef WINDOWS
+    struct stat s;
+    if (fd >= 0 && (fstat(fd, &s) || (size_t)s.st_size < offset + length))
+        return false;
+#endif
+    return true;
+}
+
+void MappedFile::willNeed(size_t offset, size_t length) const
+{
+#if !defined(WINDOWS) && defined(POSIX_FADV_WILLNEED)
+    if (fd >= 0) {
+        posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+        return;
+    }
+#endif
+#if !defined(WINDOWS) && defined(MADV_WILLNEED)
+    if (!mapped || offset >= size)
+        return;
+    // madvise wants an address aligned on a page
+    static const size_t pagesize = sysconf(_SC_PAGESIZE);
+    size_t start = offset / pagesize * pagesize;
+    size_t end = std::min(size, offset + length);
+    madvise(const_cast<uint8_t*>(data) + start, end - start, MADV_WILLNEED);
+#endif
+}
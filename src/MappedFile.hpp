@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file, shared by the providers of the frames it contains
+// (and by the images which use its samples directly).
+// Where mmap is not available, the file is read in memory instead.
+// It can also hold data which was decoded in memory (e.g. a compressed member of an archive).
+class MappedFile {
+    const uint8_t* data;
+    size_t size;
+    bool mapped;
+    std::vector<uint8_t> buffer;
+    // descriptor of the file which was mapped, kept for read(), -1 if none
+    int fd;
+
+    MappedFile();
+
+    // maps the file behind the descriptor, which is kept if 'keep', closed otherwise
+    bool map(int fd, bool keep);
+
+public:
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // nullptr if the file cannot be opened
+    static std::shared_ptr<MappedFile> open(const std::string& filename);
+
+    // POSIX shared memory object (shm_open), nullptr if it does not exist
+    static std::shared_ptr<MappedFile> openSharedMemory(const std::string& name);
+
+    static std::shared_ptr<MappedFile> fromBuffer(std::vector<uint8_t>&& buffer);
+
+    const uint8_t* getData() const
+    {
+        return data;
+    }
+
+    size_t getSize() const
+    {
+        return size;
+    }
+
+    // whether the data changes with the file (mmap), if it is modified in place
+    bool followsFile() const
+    {
+        return mapped;
+    }
+
+    // copies a range of the data, false if it is not entirely there (anymore)
+    // the mapping of a file faults (SIGBUS) past its end if the file is truncated, e.g. rewritten by np.save
+    // or by a program which starts again: the samples of a file are read with pread instead, on the descriptor
+    // which was mapped (a file replaced by a rename is still the old one, like the mapping);
+    // only the data held in memory and the shared memory objects are copied from the mapping
+    bool read(size_t offset, size_t length, void* out) const;
+
+    // whether the file still holds a range of the mapping, for the data too scattered to be copied with read():
+    // it is checked just before the range is read through the mapping, which narrows (but doesn't close)
+    // the window in which a truncation faults
+    bool holds(size_t offset, size_t length) const;
+
+    // hint that a range of the file will be read soon (with read() or through the mapping)
+    void willNeed(size_t offset, size_t length) const;
+};
@@ -8,9 +8,11 @@
 #include <doctest.h>
 #include <imgui.h>
 
+#include "ImageCache.hpp"
 #include "ImageCollection.hpp"
 #include "Player.hpp"
 #include "Sequence.hpp"
+#include "Window.hpp"
 #include "events.hpp"
 #include "globals.hpp"
 #include "strutils.hpp"
@@ -29,8 +31,6 @@ Player::Player()
     opened = false;
 
     fps = gDefaultFramerate;
-    frameClock = 0;
-    frameAccumulator = 0.;
 }
 
 bool Player::operator==(const Player& other)
@@ -40,32 +40,7 @@ bool Player::operator==(const Player& other)
 
 void Player::update()
 {
-    frameAccumulator += letTimeFlow(&frameClock);
-
-    if (!bouncy) {
-        direction = 1;
-    }
-
-    if (playing) {
-        while (frameAccumulator > 1000. / std::abs(fps)) {
-            int d = (fps >= 0 ? 1 : -1) * direction;
-            frame += d;
-            frameAccumulator -= 1000. / std::abs(fps);
-            if (bouncy) {
-                if (frame < currentMinFrame) {
-                    frame = currentMinFrame + 1;
-                    direction *= -1;
-                }
-                if (frame > currentMaxFrame) {
-                    frame = currentMaxFrame - 1;
-                    direction *= -1;
-                }
-            }
-            checkBounds();
-        }
-    } else {
-        frameAccumulator = 0.;
-    }
+    updatePlayback(std::chrono::steady_clock::now());
 
     int index = std::find(gPlayers.begin(), gPlayers.end(), shared_from_this()) - gPlayers.begin();
     char d[2] = { static_cast<char>('1' + index), 0 };
@@ -99,6 +74,122 @@ void Player::update()
     ImGui::End();
 }
 
+void Player::updatePlayback(std::chrono::steady_clock::time_point now)
+{
+    if (!bouncy) {
+        direction = 1;
+    }
+
+    if (!playing || fps == 0.f) {
+        clockRunning = false;
+        holding = false;
+        achievedFps = 0.f;
+        return;
+    }
+
+    if (!clockRunning || fps != clockFps) {
+        clockRunning = true;
+        clockFps = fps;
+        clockStart = statsStart = now;
+        clockSteps = 0;
+        statsFrames = 0;
+    }
+
+    std::chrono::duration<double> elapsed = now - clockStart;
+    long steps = static_cast<long>(std::floor(elapsed.count() * std::abs(fps))) - clockSteps;
+
+    if (steps > 0 && synchronized) {
+        // when the cache is full, the next frames are not prefetched anymore
+        std::vector<int> next = getUpcomingFrames(2);
+        bool canWaitNext = !ImageCache::isFull() && next.size() == 2;
+        if (!isCurrentFrameShown() || (canWaitNext && !isFrameAvailable(next[1]))) {
+            // wait for the slowest sequence, without accumulating delay
+            if (!holding) {
+                heldFrames++;
+            }
+            holding = true;
+            restartClock(now);
+            steps = 0;
+        }
+    }
+
+    if (steps > 0) {
+        holding = false;
+        if (!isCurrentFrameShown()) {
+            loadingFrames++;
+        }
+        if (steps > 1) {
+            if (policy == HOLD_FRAMES) {
+                lateFrames++;
+                restartClock(now);
+                steps = 1;
+            } else {
+                droppedFrames += steps - 1;
+            }
+        }
+        for (long i = 0; i < steps; i++) {
+            advance();
+        }
+        clockSteps += steps;
+        statsFrames++;
+    }
+
+    std::chrono::duration<double> window = now - statsStart;
+    if (window.count() >= 1.) {
+        achievedFps = statsFrames / window.count();
+        statsStart = now;
+        statsFrames = 0;
+    }
+}
+
+// the next frame is due now
+void Player::restartClock(std::chrono::steady_clock::time_point now)
+{
+    std::chrono::duration<double> due((clockSteps + 1) / std::abs(fps));
+    clockStart = now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(due);
+}
+
+void Player::advance()
+{
+    frame = getNextFrame(frame, direction);
+    checkBounds();
+}
+
+int Player::getNextFrame(int f, int& dir) const
+{
+    f += (fps >= 0 ? 1 : -1) * dir * std::max(step, 1);
+    if (bouncy) {
+        if (f < currentMinFrame) {
+            f = std::min(2 * currentMinFrame - f, currentMaxFrame);
+            dir *= -1;
+        }
+        if (f > currentMaxFrame) {
+            f = std::max(2 * currentMaxFrame - f, currentMinFrame);
+            dir *= -1;
+        }
+    }
+    return f;
+}
+
+std::string Player::getPolicy() const
+{
+    return policy == HOLD_FRAMES ? "hold" : "drop";
+}
+
+void Player::setPolicy(const std::string& name)
+{
+    if (name == "hold") {
+        policy = HOLD_FRAMES;
+    } else if (name == "drop") {
+        policy = DROP_FRAMES;
+    }
+}
+
+void Player::resetStats()
+{
+    lateFrames = droppedFrames = loadingFrames = heldFrames = 0;
+}
+
 void Player::displaySettings()
 {
     if (ImGui::Button("<")) {
@@ -131,9 +222,36 @@ void Player::displaySettings()
     ImGui::SliderFloat("FPS", &fps, -100.f, 100.f, "%.2f frames/s");
     ImGui::SameLine();
     ImGui::ShowHelpMarker("Change the Frame Per Second rate");
+    if (ImGui::DragInt("Step", &step, 0.2f, 1, 1000, "every %d frames")) {
+        step = std::max(step, 1);
+    }
+    ImGui::SameLine();
+    ImGui::ShowHelpMarker("Show only one frame out of N during playback, the other frames are not loaded");
     ImGui::DragIntRange2("Bounds", &currentMinFrame, &currentMaxFrame, 1.f, minFrame, maxFrame);
     ImGui::SameLine();
     ImGui::ShowHelpMarker("Change the bounds of the playback");
+    if (ImGui::Checkbox("Streaming", &streaming)) {
+        autoStreaming = false;
+    }
+    ImGui::SameLine();
+    ImGui::ShowHelpMarker("Load the next frames in a fixed number of buffers instead of the cache, for sequences which do not fit in memory (enabled automatically for them)");
+    ImGui::SameLine();
+    ImGui::Checkbox("Synchronized", &synchronized);
+    ImGui::SameLine();
+    ImGui::ShowHelpMarker("Advance only when all the sequences of the player can show the next frame");
+    int p = policy;
+    if (ImGui::Combo("Policy", &p, "Drop frames\0Hold frames\0")) {
+        policy = static_cast<Policy>(p);
+    }
+    ImGui::SameLine();
+    ImGui::ShowHelpMarker("When the display cannot keep up: skip frames to keep real time, or show every frame and play slower");
+    ImGui::Text("Achieved: %.1f frames/s", achievedFps);
+    ImGui::Text("Frames late: %lu, dropped: %lu, loading: %lu, held: %lu",
+        lateFrames, droppedFrames, loadingFrames, heldFrames);
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Reset")) {
+        resetStats();
+    }
 }
 
 void Player::checkShortcuts()
@@ -209,6 +327,66 @@ void Player::reconfigureBounds()
     checkBounds();
 }
 
+// only the sequences displayed by a window are waited for, the others may not be loaded at all
+static bool isDisplayed(const Sequence* seq)
+{
+    for (const auto& win : gWindows) {
+        int n = win->sequences.size();
+        if (win->opened && n && win->sequences[(win->index % n + n) % n].get() == seq) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// a frame is shown when every sequence has loaded it (or failed to)
+bool Player::isCurrentFrameShown() const
+{
+    for (const auto& ptr : sequences) {
+        if (const auto& seq = ptr.lock()) {
+            if (isDisplayed(seq.get()) && seq->collection && seq->collection->getLength() > 0
+                && (seq->imageprovider || seq->loadedFrame != std::min(frame, seq->collection->getLength()))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool Player::isFrameAvailable(int f) const
+{
+    for (const auto& ptr : sequences) {
+        if (const auto& seq = ptr.lock()) {
+            if (isDisplayed(seq.get()) && !seq->isFrameAvailable(f)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<int> Player::getUpcomingFrames(int count) const
+{
+    std::vector<int> frames;
+    int f = frame;
+    int dir = bouncy ? direction : 1;
+    for (int i = 0; i < count; i++) {
+        frames.push_back(f);
+        f = getNextFrame(f, dir);
+        if (f > currentMaxFrame) {
+            if (!looping)
+                break;
+            f = currentMinFrame;
+        }
+        if (f < currentMinFrame) {
+            if (!looping)
+                break;
+            f = currentMaxFrame;
+        }
+    }
+    return frames;
+}
+
 void Player::onSequenceAttach(std::weak_ptr<Sequence> s)
 {
     sequences.insert(std::move(s));
@@ -252,6 +430,33 @@ bool Player::parseArg(const std::string& arg)
                 return true;
             }
         }
+    } else if (startswith(arg, "p:step")) {
+        int new_step;
+        if (sscanf(arg.c_str(), "p:step:%d", &new_step) == 1) {
+            if (new_step >= 1) {
+                step = new_step;
+                return true;
+            }
+        }
+    } else if (startswith(arg, "p:streaming")) {
+        int new_streaming;
+        if (sscanf(arg.c_str(), "p:streaming:%d", &new_streaming) == 1) {
+            streaming = new_streaming;
+            autoStreaming = false;
+            return true;
+        }
+    } else if (startswith(arg, "p:sync")) {
+        int new_sync;
+        if (sscanf(arg.c_str(), "p:sync:%d", &new_sync) == 1) {
+            synchronized = new_sync;
+            return true;
+        }
+    } else if (startswith(arg, "p:policy:")) {
+        std::string name = arg.substr(9);
+        if (name == "drop" || name == "hold") {
+            setPolicy(name);
+            return true;
+        }
     } else if (startswith(arg, "p:frame:")) {
         int new_frame;
         if (sscanf(arg.c_str(), "p:frame:%d", &new_frame) == 1) {
@@ -318,6 +523,47 @@ TEST_CASE("Player::parseArg")
         }
     }
 
+    SUBCASE("p:step")
+    {
+        CHECK(p.step == 1);
+        CHECK(p.parseArg("p:step:10"));
+        CHECK(p.step == 10);
+        CHECK(!p.parseArg("p:step:0"));
+        CHECK(p.step == 10);
+    }
+
+    SUBCASE("p:streaming")
+    {
+        CHECK(!p.streaming);
+        CHECK(p.autoStreaming);
+        CHECK(p.parseArg("p:streaming:1"));
+        CHECK(p.streaming);
+        CHECK(!p.autoStreaming);
+        CHECK(p.parseArg("p:streaming:0"));
+        CHECK(!p.streaming);
+    }
+
+    SUBCASE("p:sync")
+    {
+        CHECK(!p.synchronized);
+        CHECK(p.parseArg("p:sync:1"));
+        CHECK(p.synchronized);
+        CHECK(p.parseArg("p:sync:0"));
+        CHECK(!p.synchronized);
+    }
+
+    SUBCASE("p:policy")
+    {
+        CHECK(p.policy == Player::DROP_FRAMES);
+        CHECK(p.parseArg("p:policy:hold"));
+        CHECK(p.policy == Player::HOLD_FRAMES);
+        CHECK(p.getPolicy() == "hold");
+        CHECK(!p.parseArg("p:policy:skip"));
+        CHECK(p.policy == Player::HOLD_FRAMES);
+        CHECK(p.parseArg("p:policy:drop"));
+        CHECK(p.policy == Player::DROP_FRAMES);
+    }
+
     SUBCASE("p:frame")
     {
         CHECK(p.frame == 1);
@@ -330,3 +576,108 @@ TEST_CASE("Player::parseArg")
         }
     }
 }
+
+TEST_CASE("Player::getUpcomingFrames")
+{
+    Player p;
+    p.currentMinFrame = 1;
+    p.currentMaxFrame = 5;
+    p.frame = 3;
+
+    SUBCASE("looping")
+    {
+        CHECK(p.getUpcomingFrames(6) == std::vector<int> { 3, 4, 5, 1, 2, 3 });
+    }
+
+    SUBCASE("not looping")
+    {
+        p.looping = false;
+        CHECK(p.getUpcomingFrames(6) == std::vector<int> { 3, 4, 5 });
+    }
+
+    SUBCASE("backward")
+    {
+        p.fps = -10;
+        CHECK(p.getUpcomingFrames(4) == std::vector<int> { 3, 2, 1, 5 });
+    }
+
+    SUBCASE("bouncy")
+    {
+        p.bouncy = true;
+        CHECK(p.getUpcomingFrames(7) == std::vector<int> { 3, 4, 5, 4, 3, 2, 1 });
+    }
+
+    SUBCASE("step")
+    {
+        p.step = 2;
+        CHECK(p.getUpcomingFrames(4) == std::vector<int> { 3, 5, 1, 3 });
+        p.bouncy = true;
+        p.frame = 1;
+        CHECK(p.getUpcomingFrames(5) == std::vector<int> { 1, 3, 5, 3, 1 });
+    }
+}
+
+TEST_CASE("Player::updatePlayback")
+{
+    using ms = std::chrono::milliseconds;
+    Player p;
+    p.currentMinFrame = 1;
+    p.currentMaxFrame = 100;
+    p.fps = 10;
+    p.playing = true;
+    auto t0 = std::chrono::steady_clock::now();
+    p.updatePlayback(t0);
+    CHECK(p.frame == 1);
+
+    SUBCASE("real time")
+    {
+        p.updatePlayback(t0 + ms(50));
+        CHECK(p.frame == 1);
+        p.updatePlayback(t0 + ms(150));
+        CHECK(p.frame == 2);
+        p.updatePlayback(t0 + ms(250));
+        CHECK(p.frame == 3);
+        CHECK(p.droppedFrames == 0);
+        p.updatePlayback(t0 + ms(1050));
+        CHECK(p.frame == 11);
+        CHECK(p.droppedFrames == 7);
+        CHECK(p.achievedFps == doctest::Approx(3 / 1.05));
+    }
+
+    SUBCASE("hold frames")
+    {
+        p.policy = Player::HOLD_FRAMES;
+        p.updatePlayback(t0 + ms(350));
+        CHECK(p.frame == 2);
+        CHECK(p.lateFrames == 1);
+        // the clock restarted when the late frame was shown
+        p.updatePlayback(t0 + ms(420));
+        CHECK(p.frame == 2);
+        p.updatePlayback(t0 + ms(460));
+        CHECK(p.frame == 3);
+        CHECK(p.lateFrames == 1);
+        CHECK(p.droppedFrames == 0);
+    }
+
+    SUBCASE("step")
+    {
+        p.step = 10;
+        p.updatePlayback(t0 + ms(150));
+        CHECK(p.frame == 11);
+        p.updatePlayback(t0 + ms(350));
+        CHECK(p.frame == 31);
+        CHECK(p.droppedFrames == 1);
+    }
+
+    SUBCASE("pause")
+    {
+        p.playing = false;
+        p.updatePlayback(t0 + ms(550));
+        CHECK(p.frame == 1);
+        p.playing = true;
+        p.updatePlayback(t0 + ms(600));
+        CHECK(p.frame == 1);
+        p.updatePlayback(t0 + ms(710));
+        CHECK(p.frame == 2);
+    }
+}
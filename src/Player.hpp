@@ -1,9 +1,11 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 struct Sequence;
 
@@ -25,9 +27,29 @@ public:
     bool looping = true;
     bool bouncy = false;
     int direction = 1;
+    // number of frames to advance at each tick, to skim long sequences
+    int step = 1;
+    // load the next frames in a ring of buffers instead of the cache (see FrameStream)
+    bool streaming = false;
+    // turn streaming on when a sequence does not fit in the cache, until the user decides
+    bool autoStreaming = true;
+    // advance only when all the sequences can show the next frame
+    bool synchronized = false;
+    bool holding = false;
 
-    uint64_t frameClock;
-    double frameAccumulator;
+    // what to do when the display does not keep up with the frame rate
+    enum Policy {
+        DROP_FRAMES, // skip frames to keep real time
+        HOLD_FRAMES, // show every frame, playing slower than real time
+    };
+    Policy policy = DROP_FRAMES;
+
+    // playback statistics
+    float achievedFps = 0.f; // distinct frames shown per second
+    size_t lateFrames = 0; // frames shown after the next one was due (HOLD_FRAMES)
+    size_t droppedFrames = 0; // frames skipped to keep real time (DROP_FRAMES)
+    size_t loadingFrames = 0; // frames whose time ended while a sequence was still loading them
+    size_t heldFrames = 0; // frames delayed because a sequence was not ready (synchronized)
 
     bool opened;
 
@@ -36,13 +58,38 @@ public:
     bool operator==(const Player& other);
 
     void update();
+    // advance the frame according to the playback clock, independently of the UI
+    void updatePlayback(std::chrono::steady_clock::time_point now);
     void displaySettings();
     void checkShortcuts();
     void checkBounds();
     void reconfigureBounds();
 
+    // frames that will be shown, in order, starting with the current one
+    std::vector<int> getUpcomingFrames(int count) const;
+
     void onSequenceAttach(std::weak_ptr<struct Sequence> s);
     void onSequenceDetach(std::weak_ptr<struct Sequence> s);
 
     bool parseArg(const std::string& arg);
+
+    std::string getPolicy() const;
+    void setPolicy(const std::string& name);
+    void resetStats();
+
+private:
+    // the frames are due at regular intervals since clockStart, whatever the UI does in between
+    bool clockRunning = false;
+    float clockFps;
+    std::chrono::steady_clock::time_point clockStart;
+    long clockSteps; // frames advanced since clockStart
+    std::chrono::steady_clock::time_point statsStart;
+    int statsFrames;
+
+    void restartClock(std::chrono::steady_clock::time_point now);
+    void advance();
+    // frame after f (before wrapping around the bounds), dir is updated when bouncing
+    int getNextFrame(int f, int& dir) const;
+    bool isCurrentFrameShown() const;
+    bool isFrameAvailable(int f) const;
 };
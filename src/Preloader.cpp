@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+#include "ImageCache.hpp"
+#include "ImageCollection.hpp"
+#include "ImageProvider.hpp"
+#include "Preloader.hpp"
+#include "events.hpp"
+
+Preloader::Preloader()
+    : cursor(0)
+    , cached(0)
+    , frameBytes(0)
+    , fits(false)
+    , loadedAtStart(0)
+    , clock(0)
+    , elapsed(0.)
+{
+}
+
+size_t Preloader::update(const std::shared_ptr<ImageCollection>& newCollection, const std::vector<int>& upcoming,
+    size_t newFrameBytes, size_t budget)
+{
+    std::lock_guard<std::mutex> _lock(mutex);
+    std::vector<int> newSorted = upcoming;
+    std::sort(newSorted.begin(), newSorted.end());
+    if (newCollection != collection || newSorted != sorted) {
+        collection = newCollection;
+        frames = upcoming;
+        sorted = std::move(newSorted);
+        cursor = 0;
+        loadedAtStart = 0;
+        clock = 0;
+        elapsed = 0.;
+    }
+    frameBytes = newFrameBytes;
+
+    // the frames can also be loaded by the prefetch, or evicted by the frames of other sequences
+    cached = 0;
+    for (int index : frames) {
+        std::string key = collection->getKey(index);
+        if (ImageCache::has(key) || ImageCache::Error::has(key))
+            cached++;
+    }
+    if (cursor >= frames.size() && cached < frames.size()) {
+        cursor = 0;
+    }
+
+    size_t missing = frameBytes * (frames.size() - cached);
+    fits = frameBytes && missing <= budget;
+    return missing;
+}
+
+std::shared_ptr<ImageProvider> Preloader::getNext()
+{
+    std::unique_lock<std::mutex> lk(mutex);
+    if (!fits || !collection)
+        return nullptr;
+
+    // skip the frames which are already loaded (by the prefetch or by the previous calls)
+    while (cursor < frames.size()) {
+        std::string key = collection->getKey(frames[cursor]);
+        if (!ImageCache::has(key) && !ImageCache::Error::has(key))
+            break;
+        cursor++;
+    }
+    if (cursor >= frames.size()) {
+        return nullptr;
+    }
+
+    if (!clock) {
+        loadedAtStart = cached;
+    }
+    elapsed += letTimeFlow(&clock) / 1000.;
+
+    std::shared_ptr<ImageCollection> c = collection;
+    int index = frames[cursor];
+    lk.unlock();
+    return c->getImageProvider(index);
+}
+
+bool Preloader::isDone() const
+{
+    std::lock_guard<std::mutex> _lock(mutex);
+    return cursor >= frames.size();
+}
+
+Preloader::Status Preloader::getStatus() const
+{
+    std::lock_guard<std::mutex> _lock(mutex);
+    Status status;
+    status.frames = frames.size();
+    status.loaded = cached;
+    status.needed = frameBytes * status.frames;
+    status.fits = fits;
+    status.mbps = 0.;
+    status.eta = -1.;
+    int loadedHere = status.loaded - loadedAtStart;
+    if (elapsed > 0. && loadedHere > 0) {
+        status.mbps = loadedHere * frameBytes / 1e6 / elapsed;
+        status.eta = (status.frames - status.loaded) * elapsed / loadedHere;
+    }
+    return status;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ImageCollection;
+class ImageProvider;
+
+// Loads all the frames of a sequence (within the bounds of its player) in the cache,
+// so that a review session can be played without waiting for the loader.
+// Only the frames that the player will show are loaded, in the order it shows them
+// (e.g. one out of 'step' frames, in the phase of the current frame).
+class Preloader {
+public:
+    struct Status {
+        int frames; // frames to preload
+        int loaded; // frames already in the cache
+        size_t needed; // memory needed by all the frames, in bytes (0 if unknown yet)
+        bool fits; // whether they fit in the cache
+        double mbps; // loading throughput
+        double eta; // in seconds, negative if unknown
+    };
+
+private:
+    mutable std::mutex mutex;
+    std::shared_ptr<ImageCollection> collection;
+    // indices of the collection, in playback order
+    std::vector<int> frames;
+    // the same, sorted
+    std::vector<int> sorted;
+    size_t cursor;
+    // frames of the preload in the cache, as of the last update
+    size_t cached;
+    size_t frameBytes;
+    bool fits;
+    int loadedAtStart;
+    uint64_t clock;
+    double elapsed;
+
+public:
+    Preloader();
+
+    // upcoming are the indices of the collection that the player will show (see Player::getUpcomingFrames),
+    // frameBytes the size of one frame in memory
+    // the preload starts again when the player leaves them (other bounds or step, or another phase)
+    // budget is the free space of the cache left to this preload
+    // returns the memory needed by the frames which are not in the cache yet
+    size_t update(const std::shared_ptr<ImageCollection>& collection, const std::vector<int>& upcoming,
+        size_t frameBytes, size_t budget);
+
+    // next frame to load, nullptr if the preload is done (or does not fit)
+    std::shared_ptr<ImageProvider> getNext();
+
+    bool isDone() const;
+
+    Status getStatus() const;
+};
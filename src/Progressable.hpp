@@ -1,9 +1,46 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
+
+#include "globals.hpp"
+
 class Progressable {
 public:
     virtual float getProgressPercentage() const = 0;
     virtual bool isLoaded() const = 0;
     virtual void progress() = 0;
     virtual ~Progressable() = default;
+
+    // whether progress() can't advance until another thread provides data (e.g. the next frames of a pipe):
+    // the loaders then set it aside and look for other work, they are notified when the data arrives
+    virtual bool isWaiting() const
+    {
+        return false;
+    }
+};
+
+// whether a loader has something to do with p
+static inline bool canProgress(const std::shared_ptr<Progressable>& p)
+{
+    return p && !p->isLoaded() && !p->isWaiting();
+}
+
+// Time budget of one progress() call.
+// Incremental loaders keep working until it is exhausted (at least one step is done),
+// so that the overhead of the loading loop is amortized while cancellation stays responsive.
+class ProgressBudget {
+    std::chrono::steady_clock::time_point deadline;
+
+public:
+    ProgressBudget(float ms = gProgressQuantumMS)
+        : deadline(std::chrono::steady_clock::now()
+            + std::chrono::microseconds(static_cast<long>(ms * 1000)))
+    {
+    }
+
+    bool exhausted() const
+    {
+        return std::chrono::steady_clock::now() >= deadline;
+    }
 };
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifndef WINDOWS
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Readahead.hpp"
+#include "globals.hpp"
+
+namespace Readahead {
+
+static std::mutex lock;
+static std::condition_variable cv;
+static std::thread thread;
+static bool running = false;
+// files of the plan which were not read ahead yet
+static std::deque<std::string> pending;
+// files read ahead but not yet opened by a decoder, with the number of bytes requested
+static std::unordered_map<std::string, size_t> issued;
+static size_t inflight = 0;
+static Stats stats;
+
+static size_t limit()
+{
+    return gReadaheadMB * 1000000;
+}
+
+// returns the number of bytes the kernel was asked to fetch
+static size_t advise(const std::string& filename, size_t maxbytes)
+{
+#if !defined(WINDOWS) && defined(POSIX_FADV_WILLNEED)
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return 0;
+    size_t len = 0;
+    struct stat s;
+    if (!fstat(fd, &s) && S_ISREG(s.st_mode)) {
+        len = std::min(static_cast<size_t>(s.st_size), maxbytes);
+        // WILLNEED starts the reads asynchronously, the pages stay in the page cache
+        if (len && posix_fadvise(fd, 0, len, POSIX_FADV_WILLNEED))
+            len = 0;
+    }
+    close(fd);
+    return len;
+#else
+    return 0;
+#endif
+}
+
+static void run()
+{
+    std::unique_lock<std::mutex> lk(lock);
+    while (running) {
+        cv.wait(lk, [] { return !running || (!pending.empty() && inflight < limit()); });
+        if (!running)
+            break;
+
+        std::string filename = pending.front();
+        pending.pop_front();
+        size_t budget = limit() - inflight;
+
+        lk.unlock();
+        auto start = std::chrono::steady_clock::now();
+        size_t bytes = advise(filename, budget);
+        auto end = std::chrono::steady_clock::now();
+        lk.lock();
+
+        stats.ms += std::chrono::duration<double, std::milli>(end - start).count();
+        if (bytes) {
+            stats.issued++;
+            stats.bytes += bytes;
+            issued[filename] = bytes;
+            inflight += bytes;
+        }
+    }
+}
+
+void start()
+{
+    if (gReadaheadDepth <= 0 || running)
+        return;
+    running = true;
+    thread = std::thread(run);
+}
+
+void stop()
+{
+    {
+        std::lock_guard<std::mutex> _lock(lock);
+        running = false;
+    }
+    cv.notify_one();
+    if (thread.joinable())
+        thread.join();
+}
+
+void plan(const std::vector<std::string>& filenames)
+{
+    std::lock_guard<std::mutex> _lock(lock);
+    if (!running)
+        return;
+
+    std::unordered_set<std::string> wanted(filenames.begin(), filenames.end());
+    // files that left the plan no longer count in the budget, their pages are left to the kernel
+    for (auto it = issued.begin(); it != issued.end();) {
+        if (!wanted.count(it->first)) {
+            inflight -= it->second;
+            it = issued.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    pending.clear();
+    std::unordered_set<std::string> queued;
+    for (const auto& filename : filenames) {
+        if (!issued.count(filename) && queued.insert(filename).second) {
+            pending.push_back(filename);
+        }
+    }
+    cv.notify_one();
+}
+
+void onOpen(const std::string& filename)
+{
+    std::lock_guard<std::mutex> _lock(lock);
+    if (!running)
+        return;
+
+    auto it = issued.find(filename);
+    if (it != issued.end()) {
+        stats.hits++;
+        inflight -= it->second;
+        issued.erase(it);
+        cv.notify_one();
+    } else {
+        stats.misses++;
+        auto p = std::find(pending.begin(), pending.end(), filename);
+        if (p != pending.end())
+            pending.erase(p);
+    }
+}
+
+Stats getStats()
+{
+    std::lock_guard<std::mutex> _lock(lock);
+    Stats s = stats;
+    s.pending = pending.size();
+    s.inflight = inflight;
+    return s;
+}
+
+}
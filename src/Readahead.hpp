@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Asks the kernel to fetch the files that the loader will decode next,
+// so that the decoders mostly hit the page cache instead of waiting for the disk (or the network).
+namespace Readahead {
+
+struct Stats {
+    size_t issued; // files for which a readahead was issued
+    size_t bytes; // bytes requested to the kernel
+    size_t hits; // files opened by a decoder after their readahead was issued
+    size_t misses; // files opened by a decoder without readahead
+    double ms; // time spent issuing readaheads
+    size_t pending; // files of the plan waiting for their readahead
+    size_t inflight; // bytes read ahead but not yet opened
+};
+
+void start();
+
+void stop();
+
+// replace the list of files to read ahead, in order of priority
+void plan(const std::vector<std::string>& filenames);
+
+// called when a decoder is about to read the file
+void onOpen(const std::string& filename);
+
+Stats getStats();
+
+}
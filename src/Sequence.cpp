@@ -7,8 +7,10 @@
 
 #include "Colormap.hpp"
 #include "EditGUI.hpp"
+#include "FrameStream.hpp"
 #include "Histogram.hpp"
 #include "Image.hpp"
+#include "ImageCache.hpp"
 #include "ImageCollection.hpp"
 #include "ImageProvider.hpp"
 #include "Player.hpp"
@@ -30,9 +32,13 @@ Sequence::Sequence()
     player = nullptr;
     colormap = nullptr;
     image = nullptr;
+    provisionalImage = nullptr;
     imageprovider = nullptr;
+    previewprovider = nullptr;
     collection = nullptr;
     uneditedCollection = nullptr;
+    preload = gPreload;
+    preloader = nullptr;
 
     valid = false;
 
@@ -91,6 +97,24 @@ int Sequence::getDesiredFrameIndex() const
 
 void Sequence::tick()
 {
+    // a collection which grows (the output of a command, a VPP file being written) can start empty
+    if (!valid && uneditedCollection && uneditedCollection->getLength() > 0) {
+        valid = true;
+    }
+
+    if (player && player->streaming && collection && collection->getLength() > 0) {
+        if (!stream) {
+            std::atomic_store(&stream, std::make_shared<FrameStream>(gStreamingDepth));
+        }
+        std::vector<int> indices;
+        for (int f : player->getUpcomingFrames(gStreamingDepth)) {
+            indices.push_back(std::min(f, collection->getLength()) - 1);
+        }
+        stream->update(collection, indices);
+    } else if (stream) {
+        std::atomic_store(&stream, std::shared_ptr<FrameStream>());
+    }
+
     bool shouldShowDifferentFrame = false;
     if (player && collection && loadedFrame != getDesiredFrameIndex()) {
         shouldShowDifferentFrame = true;
@@ -110,17 +134,40 @@ void Sequence::tick()
         }
         gActive = std::max(gActive, 2);
         imageprovider = nullptr;
+        previewprovider = nullptr;
+        provisionalImage = nullptr;
+        // sequences which can't fit in the cache are streamed
+        if (image && player && player->autoStreaming && !player->streaming && collection->getLength() > 1) {
+            size_t bytes = image->w * image->h * image->c * sizeof(float) * collection->getLength();
+            if (bytes > gCacheLimitMB * 1000000) {
+                player->streaming = true;
+            }
+        }
         if (image) {
             auto mode = gSmoothHistogram ? Histogram::Mode::SMOOTH : Histogram::Mode::EXACT;
             image->histogram->request(image, mode);
         }
     }
 
-    if (image && colormap && !colormap->initialized) {
-        colormap->autoCenterAndRadius(image->min, image->max);
+    if (imageprovider) {
+        provisionalImage = imageprovider->getProvisionalImage();
+        // a complete preview looks better than a partially decoded frame
+        if (previewprovider && previewprovider->isLoaded()) {
+            ImageProvider::Result result = previewprovider->getResult();
+            if (result.has_value()) {
+                provisionalImage = result.value();
+            }
+        }
+    }
+
+    // min/max of a provisional image are only hints: they set up the colormap for the first provisional image,
+    // and the colormap is initialized once, with the range of the final image
+    std::shared_ptr<Image> img = image ? image : provisionalImage;
+    if (img && colormap && !colormap->initialized && (img == image || !colormap->shader)) {
+        colormap->autoCenterAndRadius(img->min, img->max);
 
         if (!colormap->shader) {
-            switch (image->c) {
+            switch (img->c) {
             case 1:
                 colormap->shader = getShader("gray");
                 break;
@@ -134,20 +181,61 @@ void Sequence::tick()
                 break;
             }
         }
-        colormap->initialized = true;
+        colormap->initialized = img == image;
     }
 }
 
 void Sequence::forgetImage()
 {
+    // the frame changes before the previous one could be loaded
+    bool scrubbing = imageprovider && !imageprovider->isLoaded();
+
     image = nullptr;
+    provisionalImage = nullptr;
+    previewprovider = nullptr;
     if (player && collection && collection->getLength() > 0) {
         int desiredFrame = getDesiredFrameIndex();
-        imageprovider = collection->getImageProvider(desiredFrame - 1);
+        if (stream) {
+            imageprovider = stream->getImageProvider(desiredFrame - 1);
+        } else {
+            imageprovider = collection->getImageProvider(desiredFrame - 1);
+            int reduction = getPreviewReduction(scrubbing);
+            if (reduction > 1 && !imageprovider->isLoaded()) {
+                previewprovider = collection->getPreviewProvider(desiredFrame - 1, reduction);
+            }
+        }
         loadedFrame = desiredFrame;
     }
 }
 
+// a view zoomed out below 50% does not need the full resolution to look right, nor does scrubbing
+int Sequence::getPreviewReduction(bool scrubbing) const
+{
+    if (!gPreviewDecode || !view)
+        return 1;
+    float zoom = view->zoom * getViewRescaleFactor();
+    int reduction = 1;
+    while (reduction < 8 && zoom * reduction * 2 <= 1.f) {
+        reduction *= 2;
+    }
+    if (scrubbing) {
+        reduction = std::max(reduction, 4);
+    }
+    return reduction;
+}
+
+bool Sequence::isFrameAvailable(int frame) const
+{
+    if (!collection || collection->getLength() == 0)
+        return true;
+    int index = std::min(frame, collection->getLength()) - 1;
+    if (stream) {
+        return stream->isLoaded(index);
+    }
+    std::string key = collection->getKey(index);
+    return ImageCache::has(key) || ImageCache::Error::has(key);
+}
+
 void Sequence::autoScaleAndBias(ImVec2 p1, ImVec2 p2, float quantile)
 {
     std::shared_ptr<Image> img = getCurrentImage();
@@ -281,6 +369,14 @@ std::shared_ptr<Image> Sequence::getCurrentImage()
     return image;
 }
 
+std::shared_ptr<Image> Sequence::getDisplayedImage()
+{
+    if (image) {
+        return image;
+    }
+    return provisionalImage;
+}
+
 float Sequence::getViewRescaleFactor() const
 {
     if (!this->view->shouldRescale) {
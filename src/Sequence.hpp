@@ -21,6 +21,8 @@ struct Image;
 struct SVG;
 class ImageCollection;
 class ImageProvider;
+class FrameStream;
+class Preloader;
 
 struct Sequence : std::enable_shared_from_this<Sequence> {
     std::string ID;
@@ -38,7 +40,15 @@ struct Sequence : std::enable_shared_from_this<Sequence> {
     std::shared_ptr<Player> player;
     std::shared_ptr<Colormap> colormap;
     std::shared_ptr<ImageProvider> imageprovider;
+    // reduced version of the frame, displayed until imageprovider is done (see PREVIEW_DECODE)
+    std::shared_ptr<ImageProvider> previewprovider;
+    // set when the player is streaming
+    std::shared_ptr<FrameStream> stream;
+    // load the whole range of the player in the cache (PRELOAD or preload:1)
+    bool preload;
+    std::shared_ptr<Preloader> preloader;
     std::shared_ptr<Image> image;
+    std::shared_ptr<Image> provisionalImage;
     std::string error;
 
     std::shared_ptr<ImageCollection> uneditedCollection;
@@ -53,11 +63,14 @@ struct Sequence : std::enable_shared_from_this<Sequence> {
 
     void tick();
     void forgetImage();
+    // whether the frame of the player can be shown without waiting for the loader
+    bool isFrameAvailable(int frame) const;
 
     void autoScaleAndBias(ImVec2 p1 = ImVec2(0, 0), ImVec2 p2 = ImVec2(0, 0), float quantile = 0.);
     void snapScaleAndBias();
 
     std::shared_ptr<Image> getCurrentImage();
+    std::shared_ptr<Image> getDisplayedImage();
     float getViewRescaleFactor() const;
     std::vector<std::shared_ptr<SVG>> getCurrentSVGs() const;
 
@@ -78,4 +91,5 @@ struct Sequence : std::enable_shared_from_this<Sequence> {
 
 private:
     int getDesiredFrameIndex() const;
+    int getPreviewReduction(bool scrubbing) const;
 };
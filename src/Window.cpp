@@ -517,7 +517,7 @@ void Window::displaySequence(Sequence& seq)
     if (seq.colormap && seq.view && seq.player) {
         if (gShowImage && seq.colormap->shader) {
             ImGui::PushClipRect(clip.Min, clip.Max, true);
-            displayarea.draw(seq.getCurrentImage(), clip.Min, winSize, *seq.colormap, *seq.view, factor);
+            displayarea.draw(seq.getDisplayedImage(), clip.Min, winSize, *seq.colormap, *seq.view, factor);
             ImGui::PopClipRect();
         }
 
@@ -801,7 +801,7 @@ void Window::displaySequence(Sequence& seq)
                 } else {
                     for (int i = 0; i < 3; i++) {
                         float newcenter = seq.colormap->center[i] + 2.f * seq.colormap->radius * delta_c * ImGui::GetIO().MouseWheel;
-                        seq.colormap->center[i] = std::min(std::max(newcenter, img->min), img->max);
+                        seq.colormap->center[i] = std::min(std::max(newcenter, img->min.load()), img->max.load());
                     }
                 }
                 seq.colormap->radius = std::max(0.f, seq.colormap->radius / (1.f - 2.f * delta_r * ImGui::GetIO().MouseWheelH));
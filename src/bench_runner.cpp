@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ImageCache.hpp"
+#include "ImageCollection.hpp"
+#include "ImageProvider.hpp"
+#include "fs.hpp"
+#include "globals.hpp"
+
+// Measures the decoding throughput of the image providers.
+// Each file is decoded with a progress quantum of 0ms (one decoding step per progress() call,
+// like the loaders used to do) and with the default quantum.
+// Directories are expanded to the files they contain (e.g. a folder of camera JPEGs),
+// and a summary of all the files is printed at the end.
+// -fast enables JPEG_FAST_DECODE.
+//
+// usage: bench [-n repetitions] [-fast] files or directories...
+
+struct BenchResult {
+    double ms;
+    size_t calls;
+    size_t frames;
+};
+
+static BenchResult decode(const std::shared_ptr<ImageCollection>& collection, int repetitions, float quantum)
+{
+    gProgressQuantumMS = quantum;
+    BenchResult res { 0., 0, 0 };
+    int frames = std::min(collection->getLength(), 10);
+    for (int r = 0; r < repetitions; r++) {
+        for (int f = 0; f < frames; f++) {
+            ImageCache::flush();
+            ImageCache::Error::flush();
+            auto start = std::chrono::steady_clock::now();
+            std::shared_ptr<ImageProvider> provider = collection->getImageProvider(f);
+            while (!provider->isLoaded()) {
+                // a provider waiting for its data (e.g. a pipe) is not progressed, as in the loaders
+                if (!canProgress(provider)) {
+                    pollGrowingCollections();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    continue;
+                }
+                provider->progress();
+                res.calls++;
+            }
+            auto end = std::chrono::steady_clock::now();
+            res.ms += std::chrono::duration<double, std::milli>(end - start).count();
+            res.frames++;
+            if (!provider->getResult().has_value()) {
+                fprintf(stderr, "error: %s\n", provider->getResult().error().c_str());
+                return res;
+            }
+        }
+    }
+    return res;
+}
+
+int main(int argc, char** argv)
+{
+    int repetitions = 5;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            repetitions = std::max(1, atoi(argv[++i]));
+        } else if (arg == "-fast") {
+            gJPEGFastDecode = true;
+        } else if (fs::is_directory(fs::path(arg))) {
+            std::vector<std::string> entries;
+            for (const auto& entry : fs::directory_iterator(fs::path(arg))) {
+                if (fs::is_regular_file(entry.path())) {
+                    entries.push_back(entry.path().u8string());
+                }
+            }
+            std::sort(entries.begin(), entries.end());
+            files.insert(files.end(), entries.begin(), entries.end());
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) {
+        fprintf(stderr, "usage: %s [-n repetitions] [-fast] files or directories...\n", argv[0]);
+        return 1;
+    }
+
+    // don't let the cache hide the decoding time
+    gCacheLimitMB = 0;
+    float defaultQuantum = gProgressQuantumMS;
+    double totalMB = 0.;
+    BenchResult total { 0., 0, 0 };
+
+    for (const auto& file : files) {
+        std::error_code ec;
+        double mb = fs::file_size(fs::path(file), ec) / 1e6;
+        auto collection = buildImageCollectionFromFilenames({ fs::path(file) });
+        if (collection->getLength() > 1) {
+            // video files: approximate the size of one frame
+            mb /= collection->getLength();
+        }
+
+        printf("%s\n", file.c_str());
+        for (float quantum : { 0.f, defaultQuantum }) {
+            BenchResult res = decode(collection, repetitions, quantum);
+            if (!res.frames) {
+                continue;
+            }
+            double perframe = res.ms / res.frames;
+            printf("  quantum %.1fms: %8.2f ms/frame %8lu calls/frame %8.1f MB/s\n",
+                static_cast<double>(quantum), perframe, res.calls / res.frames, mb / (perframe / 1000.));
+            if (quantum == defaultQuantum) {
+                total.ms += res.ms;
+                total.calls += res.calls;
+                total.frames += res.frames;
+                totalMB += mb * res.frames;
+            }
+        }
+    }
+
+    if (files.size() > 1 && total.frames) {
+        printf("total (%lu frames, quantum %.1fms): %8.2f ms/frame %8.1f MB/s\n", total.frames,
+            static_cast<double>(defaultQuantum), total.ms / total.frames, totalMB / (total.ms / 1000.));
+    }
+    return 0;
+}
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include "doctest.h"
@@ -178,9 +178,32 @@ static std::vector<std::string> collect_directory(const std::string& path)
 
 std::vector<fs::path> buildFilenamesFromExpression(const std::string& expr)
 {
+    // the output of a command (cmd:<command> or raw:<parameters>:cmd:<command>) is neither split nor globbed,
+    // nor is a shared memory ring (shm:<name>)
+    size_t command = startswith(expr, "raw:") ? expr.find(':', 4) : std::string::npos;
+    if (startswith(expr, "cmd:") || startswith(expr, "shm:") || (command != std::string::npos && expr.compare(command + 1, 4, "cmd:") == 0)) {
+        return { fs::path(expr) };
+    }
+
     std::vector<std::string> filenames;
 
     for (auto subexpr : try_split(expr)) {
+        // raw:<parameters>:<glob>, the parameters apply to each file
+        if (startswith(subexpr, "raw:")) {
+            size_t sep = subexpr.find(':', 4);
+            if (sep != std::string::npos) {
+                std::string prefix = subexpr.substr(0, sep + 1);
+                auto globres = do_glob(subexpr.substr(sep + 1));
+                if (globres.empty()) {
+                    globres.push_back(subexpr.substr(sep + 1));
+                }
+                for (const auto& file : globres) {
+                    filenames.push_back(prefix + file);
+                }
+                continue;
+            }
+        }
+
         auto globres = do_glob(subexpr);
 
         if (globres.size() == 0) {
@@ -257,6 +280,29 @@ TEST_CASE("buildFilenamesFromExpression")
             CHECK(v[1] == "../external/doctest/doctest.h");
     }
 
+    SUBCASE("raw:<parameters>:<glob>")
+    {
+        auto files = buildFilenamesFromExpression("../src/*.hpp");
+        auto v = buildFilenamesFromExpression("raw:w=2,h=2:../src/*.hpp");
+        CHECK(v.size() == files.size());
+        if (v.size() > 0)
+            CHECK(v[0] == "raw:w=2,h=2:" + files[0].u8string());
+    }
+
+    SUBCASE("cmd:<command> and shm:<name>")
+    {
+        auto v = buildFilenamesFromExpression("cmd:cat ../src/*.hpp::x");
+        CHECK(v.size() == 1);
+        if (v.size() > 0)
+            CHECK(v[0] == "cmd:cat ../src/*.hpp::x");
+        auto r = buildFilenamesFromExpression("raw:w=2,h=2:cmd:cat ../src/*.hpp");
+        CHECK(r.size() == 1);
+        auto s = buildFilenamesFromExpression("shm:vpv-1-1");
+        CHECK(s.size() == 1);
+        if (s.size() > 0)
+            CHECK(s[0] == "shm:vpv-1-1");
+    }
+
     SUBCASE("src::external (::)")
     {
         auto v1 = buildFilenamesFromExpression("../src");
@@ -319,11 +319,21 @@ void config::load()
             .addProperty("fps", &Player::fps)
             .addProperty("looping", &Player::looping)
             .addProperty("bouncy", &Player::bouncy)
+            .addProperty("step", &Player::step)
+            .addProperty("streaming", &Player::streaming)
+            .addProperty("synchronized", &Player::synchronized)
+            .addProperty("policy", &Player::getPolicy, &Player::setPolicy)
+            .addProperty("achieved_fps", &Player::achievedFps)
+            .addProperty("late_frames", &Player::lateFrames)
+            .addProperty("dropped_frames", &Player::droppedFrames)
+            .addProperty("loading_frames", &Player::loadingFrames)
+            .addProperty("held_frames", &Player::heldFrames)
             .addProperty("current_min_frame", &Player::currentMinFrame)
             .addProperty("current_max_frame", &Player::currentMaxFrame)
             .addProperty("min_frame", &Player::minFrame)
             .addProperty("max_frame", &Player::maxFrame)
-            .addFunction("check_bounds", &Player::checkBounds));
+            .addFunction("check_bounds", &Player::checkBounds)
+            .addFunction("reset_stats", &Player::resetStats));
 
     (*state)["View"].setClass(kaguya::UserdataMetatable<View>()
             .addProperty("id", &View::ID)
@@ -28,6 +28,17 @@ int gDownsamplingQuality;
 size_t gCacheLimitMB;
 bool gSmoothHistogram;
 bool gForceIioOpen;
+float gProgressQuantumMS = 3.f;
+int gReadaheadDepth;
+size_t gReadaheadMB;
+int gStreamingDepth = 16;
+bool gPreload;
+bool gPreviewDecode = true;
+bool gJPEGFastDecode = false;
+bool gTail = true;
+bool gTailJump = false;
+bool gY4MConvertToRGB = true;
+size_t gPipeBufferMB = 512;
 int gActive;
 int gShowView;
 bool gReloadImages;
@@ -35,3 +46,5 @@ bool gShowHelp = false;
 
 Terminal term;
 Terminal& gTerminal = term;
+LoadingThread* gComputeThread = nullptr;
+std::vector<LoadingThread*> gLoadingHelpers;
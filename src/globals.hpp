@@ -12,6 +12,7 @@ struct Player;
 struct Window;
 struct Colormap;
 class Terminal;
+class LoadingThread;
 
 extern std::vector<std::shared_ptr<Sequence>> gSequences;
 extern std::vector<std::shared_ptr<View>> gViews;
@@ -19,6 +20,8 @@ extern std::vector<std::shared_ptr<Player>> gPlayers;
 extern std::vector<std::shared_ptr<Window>> gWindows;
 extern std::vector<std::shared_ptr<Colormap>> gColormaps;
 extern Terminal& gTerminal;
+extern LoadingThread* gComputeThread;
+extern std::vector<LoadingThread*> gLoadingHelpers;
 
 #include <imgui.h>
 extern bool gSelecting;
@@ -42,6 +45,17 @@ extern int gDownsamplingQuality;
 extern size_t gCacheLimitMB;
 extern bool gSmoothHistogram;
 extern bool gForceIioOpen;
+extern float gProgressQuantumMS;
+extern int gReadaheadDepth;
+extern size_t gReadaheadMB;
+extern int gStreamingDepth;
+extern bool gPreload;
+extern bool gPreviewDecode;
+extern bool gJPEGFastDecode;
+extern bool gTail;
+extern bool gTailJump;
+extern bool gY4MConvertToRGB;
+extern size_t gPipeBufferMB;
 
 extern int gActive;
 extern int gShowView;
@@ -1,8 +1,10 @@
 #include <algorithm>
+#include <array>
 #include <cfloat>
 #include <cmath>
 #include <iostream>
 #include <map>
+#include <set>
 #include <string>
 #ifndef WINDOWS
 #include <sys/stat.h>
@@ -26,6 +28,7 @@
 
 #include "Colormap.hpp"
 #include "EditGUI.hpp"
+#include "FrameStream.hpp"
 #include "Histogram.hpp"
 #include "Image.hpp"
 #include "ImageCache.hpp"
@@ -33,6 +36,8 @@
 #include "ImageProvider.hpp"
 #include "LoadingThread.hpp"
 #include "Player.hpp"
+#include "Preloader.hpp"
+#include "Readahead.hpp"
 #include "SVG.hpp"
 #include "Sequence.hpp"
 #include "Shader.hpp"
@@ -54,6 +59,144 @@
 
 static void help();
 
+enum Visibility {
+    VISIBLE, // displayed by an opened window
+    NEIGHBOUR, // one space/backspace away from being displayed
+    HIDDEN,
+    NUM_VISIBILITIES,
+};
+
+// sequences grouped by how soon they can be displayed, so that hidden sequences don't take the place of visible ones
+static std::array<std::vector<std::shared_ptr<Sequence>>, NUM_VISIBILITIES> getSequencesByVisibility()
+{
+    std::array<std::vector<std::shared_ptr<Sequence>>, NUM_VISIBILITIES> sequences;
+    std::set<Sequence*> seen;
+    auto add = [&](Visibility visibility, const std::shared_ptr<Sequence>& seq) {
+        if (seq && seen.insert(seq.get()).second) {
+            sequences[visibility].push_back(seq);
+        }
+    };
+    for (const auto& win : gWindows) {
+        int n = win->sequences.size();
+        if (win->opened && n) {
+            add(VISIBLE, win->sequences[(win->index % n + n) % n]);
+        }
+    }
+    for (const auto& win : gWindows) {
+        int n = win->sequences.size();
+        if (win->opened && n > 1) {
+            int index = (win->index % n + n) % n;
+            add(NEIGHBOUR, win->sequences[(index + 1) % n]);
+            add(NEIGHBOUR, win->sequences[(index + n - 1) % n]);
+        }
+    }
+    for (const auto& seq : gSequences) {
+        add(HIDDEN, seq);
+    }
+    return sequences;
+}
+
+// frames that the io thread will load next, in order
+// only the frames that the players will show are loaded (e.g. one out of 'step' frames)
+static std::vector<std::pair<std::shared_ptr<ImageCollection>, int>> getPrefetchPlan(const std::vector<std::shared_ptr<Sequence>>& sequences)
+{
+    std::vector<std::pair<std::shared_ptr<ImageCollection>, std::vector<int>>> upcoming;
+    for (const auto& seq : sequences) {
+        // streamed sequences don't go through the cache
+        if (!seq->player || seq->player->streaming)
+            continue;
+        std::shared_ptr<ImageCollection> collection = seq->collection;
+        if (!collection || collection->getLength() == 0)
+            continue;
+        upcoming.emplace_back(collection, seq->player->getUpcomingFrames(100));
+    }
+
+    std::vector<std::pair<std::shared_ptr<ImageCollection>, int>> plan;
+    for (int i = 1; i < 100; i++) {
+        for (const auto& u : upcoming) {
+            const auto& frames = u.second;
+            if (static_cast<size_t>(i) >= frames.size())
+                continue;
+            int length = u.first->getLength();
+            int frame = std::min(frames[i], length) - 1;
+            if (frame == std::min(frames[0], length) - 1)
+                continue;
+            plan.emplace_back(u.first, frame);
+        }
+    }
+    return plan;
+}
+
+// decide which sequences can be preloaded entirely in the cache, in order, until the cache is full
+// the frames already in the cache are kept, so only the missing ones are budgeted against the free space
+static void updatePreloads()
+{
+    size_t limit = gCacheLimitMB * 1000000;
+    size_t budget = limit - std::min(limit, ImageCache::getSize());
+    for (const auto& seq : gSequences) {
+        std::shared_ptr<ImageCollection> collection = seq->collection;
+        if (!seq->preload || !seq->player || seq->player->streaming || !collection || collection->getLength() == 0) {
+            if (seq->preloader) {
+                std::atomic_store(&seq->preloader, std::shared_ptr<Preloader>());
+            }
+            continue;
+        }
+        if (!seq->preloader) {
+            std::atomic_store(&seq->preloader, std::make_shared<Preloader>());
+        }
+
+        // the frames that the player will show, starting with the current one
+        // (twice the bounds, as a bouncing player shows them on its way back)
+        const Player& player = *seq->player;
+        int length = collection->getLength();
+        int count = (player.currentMaxFrame - player.currentMinFrame) / std::max(player.step, 1) + 1;
+        std::vector<int> shown = player.getUpcomingFrames(2 * count);
+        if (!player.looping && !player.bouncy) {
+            // and those behind it, shown when the playback starts again
+            int step = (player.fps >= 0 ? -1 : 1) * std::max(player.step, 1);
+            for (int f = player.frame + step; f >= player.currentMinFrame && f <= player.currentMaxFrame; f += step) {
+                shown.push_back(f);
+            }
+        }
+        std::vector<int> upcoming;
+        std::vector<bool> seen(length);
+        for (int f : shown) {
+            int index = std::min(std::max(f, 1), length) - 1;
+            if (!seen[index]) {
+                seen[index] = true;
+                upcoming.push_back(index);
+            }
+        }
+        // the size of the frames is only known once one is loaded
+        std::shared_ptr<Image> image = seq->image;
+        size_t frameBytes = image ? image->w * image->h * image->c * sizeof(float) : 0;
+        size_t missing = seq->preloader->update(collection, upcoming, frameBytes, budget);
+        if (!frameBytes)
+            continue;
+        if (missing <= budget) {
+            budget -= missing;
+        } else if (frameBytes * upcoming.size() > limit && seq->player->autoStreaming) {
+            // the sequence can't fit whatever the other sequences do
+            seq->player->streaming = true;
+        }
+    }
+}
+
+// let the kernel fetch the files of the next frames while the current one is being decoded
+static void planReadahead(const std::vector<std::pair<std::shared_ptr<ImageCollection>, int>>& plan, size_t from)
+{
+    if (gReadaheadDepth <= 0)
+        return;
+    std::vector<std::string> filenames;
+    for (size_t i = from; i < plan.size() && filenames.size() < static_cast<size_t>(gReadaheadDepth); i++) {
+        const auto& collection = plan[i].first;
+        if (!collection->isWholeFile(plan[i].second) || ImageCache::has(collection->getKey(plan[i].second)))
+            continue;
+        filenames.push_back(collection->getFilename(plan[i].second));
+    }
+    Readahead::plan(filenames);
+}
+
 static void parseArgs(int argc, char** argv)
 {
     if (argc == 1)
@@ -95,8 +238,10 @@ static void parseArgs(int argc, char** argv)
         bool isshader = !strncmp(argv[i], "shader:", 7);
         // fromfile:
         bool isfromfile = !strncmp(argv[i], "fromfile:", 9);
+        // preload:(0|1)
+        bool ispreload = startswith(arg, "preload:");
 
-        bool iscommand = isedit || isconfig || isnewthing || isoldthing || islayout || issvg || isshader || isterm;
+        bool iscommand = isedit || isconfig || isnewthing || isoldthing || islayout || issvg || isshader || isterm || ispreload;
         bool isfile = !iscommand && !isfromfile;
         bool isanewsequence = isfile || isfromfile;
 
@@ -197,6 +342,11 @@ static void parseArgs(int argc, char** argv)
             svgglobs[seq].push_back(glob);
         }
 
+        if (ispreload && has_one_sequence) {
+            const auto& seq = gSequences[gSequences.size() - 1];
+            seq->preload = atoi(&arg[8]);
+        }
+
         if (isshader) {
             std::string shader(&argv[i][7]);
             if (!colormap->setShader(shader)) {
@@ -411,6 +561,16 @@ int main(int argc, char* argv[])
     gCacheLimitMB = config::get_lua()["toMB"](config::get_string("CACHE_LIMIT"));
     gSmoothHistogram = config::get_bool("SMOOTH_HISTOGRAM");
     gForceIioOpen = config::get_bool("FORCE_IIO_OPEN");
+    gReadaheadDepth = config::get_int("READAHEAD_DEPTH");
+    gReadaheadMB = config::get_lua()["toMB"](config::get_string("READAHEAD_SIZE"));
+    gStreamingDepth = std::max(2, config::get_int("STREAMING_DEPTH"));
+    gPreload = config::get_bool("PRELOAD");
+    gPreviewDecode = config::get_bool("PREVIEW_DECODE");
+    gJPEGFastDecode = config::get_bool("JPEG_FAST_DECODE");
+    gTail = config::get_bool("TAIL");
+    gTailJump = config::get_bool("TAIL_JUMP");
+    gY4MConvertToRGB = config::get_bool("Y4M_RGB");
+    gPipeBufferMB = config::get_lua()["toMB"](config::get_string("PIPE_BUFFER"));
 
     parseLayout(config::get_string("DEFAULT_LAYOUT"));
 
@@ -434,35 +594,89 @@ int main(int argc, char* argv[])
     relayout();
 
     SleepyLoadingThread<Progressable> iothread([]() -> std::shared_ptr<Progressable> {
-        // fill the queue with images to be displayed
-        for (const auto& seq : gSequences) {
-            std::shared_ptr<Progressable> provider = seq->imageprovider;
-            if (provider && !provider->isLoaded()) {
+        auto sequences = getSequencesByVisibility();
+        // hidden sequences are only loaded if they can't evict the frames of the visible ones
+        bool spare = !ImageCache::isFull() && ImageCache::getSize() < gCacheLimitMB * 1000000 / 2;
+
+        // previews are cheap and shown until their frame is loaded
+        for (const auto& seq : sequences[VISIBLE]) {
+            std::shared_ptr<Progressable> provider = seq->previewprovider;
+            if (canProgress(provider)) {
                 return provider;
             }
         }
 
-        if (!ImageCache::isFull()) {
-            // fill the queue with futur frames
-            for (int i = 1; i < 100; i++) {
-                for (const auto& seq : gSequences) {
-                    if (!seq->player)
-                        continue;
-                    std::shared_ptr<ImageCollection> collection = seq->collection;
-                    if (!collection || collection->getLength() == 0)
-                        continue;
-                    int frame = (seq->player->frame + i - 1) % collection->getLength();
-                    if (frame == seq->player->frame - 1)
-                        continue;
-                    std::shared_ptr<ImageProvider> provider = collection->getImageProvider(frame);
-                    if (!provider->isLoaded()) {
-                        return provider;
+        // fill the queue with images to be displayed
+        for (auto visibility : { VISIBLE, NEIGHBOUR, HIDDEN }) {
+            if (visibility == HIDDEN && !spare)
+                break;
+            for (const auto& seq : sequences[visibility]) {
+                std::shared_ptr<Progressable> provider = seq->imageprovider;
+                if (canProgress(provider)) {
+                    return provider;
+                }
+            }
+        }
+
+        // fill the rings of the streamed sequences, in play order
+        for (auto visibility : { VISIBLE, NEIGHBOUR }) {
+            for (const auto& seq : sequences[visibility]) {
+                std::shared_ptr<FrameStream> stream = std::atomic_load(&seq->stream);
+                if (!stream)
+                    continue;
+                std::shared_ptr<ImageProvider> provider = stream->getNextToLoad();
+                if (provider) {
+                    std::vector<std::string> filenames = stream->getPendingFilenames();
+                    if (!filenames.empty()) {
+                        filenames.erase(filenames.begin());
                     }
+                    if (gReadaheadDepth > 0) {
+                        filenames.resize(std::min(filenames.size(), static_cast<size_t>(gReadaheadDepth)));
+                        Readahead::plan(filenames);
+                    }
+                    return provider;
+                }
+            }
+        }
+
+        // fill the queue with futur frames
+        auto prefetch = [&sequences](Visibility visibility) -> std::shared_ptr<ImageProvider> {
+            if (ImageCache::isFull())
+                return nullptr;
+            auto plan = getPrefetchPlan(sequences[visibility]);
+            for (size_t i = 0; i < plan.size(); i++) {
+                std::shared_ptr<ImageProvider> provider = plan[i].first->getImageProvider(plan[i].second);
+                if (canProgress(provider)) {
+                    planReadahead(plan, i + 1);
+                    return provider;
                 }
             }
+            return nullptr;
+        };
+        if (auto provider = prefetch(VISIBLE)) {
+            return provider;
+        }
+        // then the rest of the preloaded sequences, they were checked to fit in the cache
+        for (const auto& seq : gSequences) {
+            std::shared_ptr<Preloader> preloader = std::atomic_load(&seq->preloader);
+            if (!preloader)
+                continue;
+            std::shared_ptr<ImageProvider> provider = preloader->getNext();
+            if (canProgress(provider)) {
+                return provider;
+            }
+        }
+        if (auto provider = prefetch(NEIGHBOUR)) {
+            return provider;
+        }
+        if (spare) {
+            if (auto provider = prefetch(HIDDEN)) {
+                return provider;
+            }
         }
         return nullptr;
     });
+    Readahead::start();
     iothread.start();
 
     LoadingThread computethread([]() -> std::shared_ptr<Progressable> {
@@ -470,7 +684,7 @@ int main(int argc, char* argv[])
             return nullptr;
         for (const auto& w : gWindows) {
             std::shared_ptr<Progressable> provider = w->histogram;
-            if (provider && !provider->isLoaded()) {
+            if (canProgress(provider)) {
                 return provider;
             }
         }
@@ -478,14 +692,24 @@ int main(int argc, char* argv[])
             if (!seq->image)
                 continue;
             std::shared_ptr<Progressable> provider = seq->image->histogram;
-            if (provider && !provider->isLoaded()) {
+            if (canProgress(provider)) {
                 return provider;
             }
         }
         return nullptr;
     });
+    gComputeThread = &computethread;
     computethread.start();
 
+    // helper threads load independent tasks in parallel (e.g. the inputs of edits)
+    std::vector<std::shared_ptr<LoadingThread>> helpers;
+    int numHelpers = std::min(8, std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1));
+    for (int i = 0; i < numHelpers; i++) {
+        helpers.push_back(std::make_shared<LoadingThread>(popLoadingTask));
+        gLoadingHelpers.push_back(helpers.back().get());
+        helpers.back()->start();
+    }
+
     if (gSequences.empty()) {
         gShowHelp = true;
     }
@@ -539,10 +763,30 @@ int main(int argc, char* argv[])
         }
 
         watcher_check();
+        if (pollGrowingCollections()) {
+            // the providers set aside while waiting for these frames can progress again
+            iothread.notify();
+        }
 
+        // hidden sequences are picked up by the periodic notification, when there is room for them
+        auto sequencesByVisibility = getSequencesByVisibility();
+        for (auto visibility : { VISIBLE, NEIGHBOUR }) {
+            for (const auto& seq : sequencesByVisibility[visibility]) {
+                std::shared_ptr<Progressable> provider = seq->imageprovider;
+                if (canProgress(provider)) {
+                    iothread.notify();
+                }
+                if (seq->stream) {
+                    FrameStream::Stats stats = seq->stream->getStats();
+                    if (stats.ready < stats.depth) {
+                        iothread.notify();
+                    }
+                }
+            }
+        }
+        updatePreloads();
         for (const auto& seq : gSequences) {
-            std::shared_ptr<Progressable> provider = seq->imageprovider;
-            if (provider && !provider->isLoaded()) {
+            if (seq->preloader && seq->preloader->getStatus().fits && !seq->preloader->isDone()) {
                 iothread.notify();
             }
         }
@@ -556,6 +800,9 @@ int main(int argc, char* argv[])
             // SAD!
             ImageCache::Error::flush();
             for (const auto& seq : gSequences) {
+                if (seq->stream) {
+                    seq->stream->flush();
+                }
                 seq->forgetImage();
             }
             current_inactive = false;
@@ -618,6 +865,10 @@ int main(int argc, char* argv[])
         if (isKeyPressed("F11")) {
             ImageCache::flush();
             SVG::flushCache();
+            // the preloads start over
+            for (const auto& seq : gSequences) {
+                std::atomic_store(&seq->preloader, std::shared_ptr<Preloader>());
+            }
         }
 
         if (isKeyPressed("l")) {
@@ -639,6 +890,7 @@ int main(int argc, char* argv[])
         if (isKeyPressed("h") && isKeyDown("shift")) {
             gShowHistogram = !gShowHistogram;
             gShowHud |= gShowHistogram;
+            computethread.notify();
         }
 
         for (int i = 0; i < 9; i++) {
@@ -696,12 +948,21 @@ int main(int argc, char* argv[])
         }
     }
 
+    // the helpers first, as the other threads push tasks to them until they stop
+    stopLoadingHelpers();
     iothread.stop();
     computethread.stop();
+    Readahead::stop();
+    gComputeThread = nullptr;
 
     bool allow_brutal_exit = false;
     auto future_io = std::async(std::launch::async, [&iothread] { iothread.join(); });
     auto future_compute = std::async(std::launch::async, [&computethread] { computethread.join(); });
+    auto future_helpers = std::async(std::launch::async, [&helpers] {
+        for (const auto& h : helpers) {
+            h->join();
+        }
+    });
     auto future_terminal = std::async(std::launch::async, [] { gTerminal.stopAllAndJoin(); });
     // If the threads are not joinable within a short amount of time (for instance, if iio/gdal loads a big image),
     // we allow the programm to exit brutally.
@@ -711,6 +972,9 @@ int main(int argc, char* argv[])
     if (future_compute.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout) {
         allow_brutal_exit = true;
     }
+    if (future_helpers.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout) {
+        allow_brutal_exit = true;
+    }
     if (future_terminal.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout) {
         allow_brutal_exit = true;
     }
@@ -751,6 +1015,10 @@ static void help()
         T("Each sequence has a colormap, a view and a player.\nThose objects can be shared by multiple sequences.");
         T("A sequence is displayed on a window.");
         ImGui::TextDisabled("sequence definition (glob, ::)");
+        T("Headerless files are opened with raw:w=...,h=...,c=1,type=u16le,layout=planar,offset=0,frames=auto:file (the parameters other than w and h are optional, type is one of u8, i8, u16, i16, u32, i32, u64, i64, f16, f32, f64 with an optional le or be suffix).");
+        T("The output of a command is opened with cmd:command, if it writes .npy arrays or a VPP stream. Raw frames are given with raw:w=...,h=...:cmd:command. The frames are shown as they arrive.");
+        T("Data piped to vpv (or -) is streamed in the same way (raw:w=...,h=...:- for raw frames). Other formats are shown as a single image once the input is complete.");
+        T("The frames pushed by a program in a shared memory ring are shown with shm:name (see misc/vpv.py for the producer side).");
         T("Shortcuts");
         B();
         T("!: remove the current image from the sequence");
@@ -886,7 +1154,17 @@ static void help()
         T("Here is the default configuration (might not be up-to-date):");
         static char text[] = "SCALE = 1"
                              "\nWATCH = false"
+                             "\nPRELOAD = false"
                              "\nCACHE_LIMIT = '2GB'"
+                             "\nREADAHEAD_DEPTH = 8"
+                             "\nREADAHEAD_SIZE = '256MB'"
+                             "\nSTREAMING_DEPTH = 16"
+                             "\nPREVIEW_DECODE = true"
+                             "\nJPEG_FAST_DECODE = false"
+                             "\nTAIL = true"
+                             "\nTAIL_JUMP = false"
+                             "\nY4M_RGB = true"
+                             "\nPIPE_BUFFER = '512MB'"
                              "\nSCREENSHOT = 'screenshot_%d.png'"
                              "\nWINDOW_WIDTH = 1024"
                              "\nWINDOW_HEIGHT = 720"
@@ -915,6 +1193,20 @@ static void help()
         B();
         T("Setting CACHE to 0 disables the caching of the images. This slows down vpv but also makes it use less RAM.");
         B();
+        T("Setting PRELOAD to true loads every frame of the sequences (within the bounds of their player) in the cache, if they fit in it. Sequences which do not fit are streamed instead. Use preload:0 or preload:1 after a sequence on the command line to change this for the sequence. The progress is shown in the Loader menu.");
+        B();
+        T("With PREVIEW_DECODE, JPEG frames are first decoded at a reduced resolution (1/2 to 1/8) when the view is zoomed out below 50%% or when the frames change faster than they load. The full resolution is loaded right after.");
+        B();
+        T("JPEG_FAST_DECODE uses the fast integer DCT and the simple upsampling of libjpeg: faster, but the pixel values are not exactly the ones of the reference decoder.");
+        B();
+        T("With TAIL, the VPP files which grow while they are displayed (e.g. written frame by frame by a simulation) are followed: the new frames are added to the sequence. Setting TAIL_JUMP to true also moves the players which show the last frame to the newest one (this also applies to the output of commands).");
+        B();
+        T("The frames output by a command (cmd:command) are kept in a history of at most PIPE_BUFFER. The command is only read ahead of the displayed frame by half of it, and it is started again when an older frame is requested. Data piped to vpv is read as soon as it arrives: only the frames which are still in the history can be shown, and the players showing the last frame follow the new ones.");
+        B();
+        T("Y4M videos are converted to RGB (BT.601). With Y4M_RGB set to false, the Y, U and V planes are shown as the channels of the image instead, without conversion (the chroma is repeated for the subsampled pixels). The frames of large Y4M files are indexed in a .vpvidx file next to them, so that they open instantly the next time.");
+        B();
+        T("READAHEAD_DEPTH is the number of upcoming files that the kernel is asked to read in advance, so that the decoding does not wait for the disk. READAHEAD_SIZE limits the amount of data read ahead. The statistics are shown in the Loader menu.");
+        B();
         T("SCALE allows to rescale vpv's interface (might be useful for high-density displays).");
         ImGui::Spacing();
         T("Shortcuts");
@@ -3,8 +3,11 @@
 #include <imgui.h>
 
 #include "Colormap.hpp"
+#include "FrameStream.hpp"
 #include "ImageCollection.hpp"
 #include "Player.hpp"
+#include "Preloader.hpp"
+#include "Readahead.hpp"
 #include "Sequence.hpp"
 #include "View.hpp"
 #include "Window.hpp"
@@ -160,6 +163,45 @@ void menu()
             ImGui::EndMenu();
         }
 
+        if (ImGui::BeginMenu("Loader")) {
+            Readahead::Stats stats = Readahead::getStats();
+            if (gReadaheadDepth > 0) {
+                ImGui::Text("Readahead: %d files, %luMB", gReadaheadDepth, gReadaheadMB);
+                ImGui::Text("Issued: %lu files (%.1fMB) in %.1fms", stats.issued, stats.bytes / 1e6, stats.ms);
+                ImGui::Text("Pending: %lu files, %.1fMB read ahead but not yet opened", stats.pending, stats.inflight / 1e6);
+                size_t opened = stats.hits + stats.misses;
+                ImGui::Text("Opened by decoders: %lu hits, %lu misses (%.0f%% hit)", stats.hits, stats.misses,
+                    opened ? 100. * stats.hits / opened : 0.);
+            } else {
+                ImGui::Text("Readahead: disabled");
+            }
+            for (const auto& seq : gSequences) {
+                if (!seq->preloader)
+                    continue;
+                Preloader::Status s = seq->preloader->getStatus();
+                char overlay[128];
+                snprintf(overlay, sizeof(overlay), "%s: %d/%d frames", seq->ID.c_str(), s.loaded, s.frames);
+                ImGui::ProgressBar(s.frames ? static_cast<float>(s.loaded) / s.frames : 0.f, ImVec2(300, 0), overlay);
+                if (!s.needed) {
+                    ImGui::Text("waiting for the first frame to estimate the memory");
+                } else if (!s.fits) {
+                    ImGui::Text("needs %.0fMB, does not fit in the cache (%luMB)", s.needed / 1e6, gCacheLimitMB);
+                } else if (s.eta >= 0.) {
+                    ImGui::Text("needs %.0fMB of %luMB, %.1fMB/s, ETA %.0fs", s.needed / 1e6, gCacheLimitMB, s.mbps, s.eta);
+                } else {
+                    ImGui::Text("needs %.0fMB of %luMB", s.needed / 1e6, gCacheLimitMB);
+                }
+            }
+            for (const auto& seq : gSequences) {
+                if (!seq->stream)
+                    continue;
+                FrameStream::Stats s = seq->stream->getStats();
+                ImGui::Text("%s: streaming, %lu/%lu frames ready, %lu hits, %lu misses",
+                    seq->ID.c_str(), s.ready, s.depth, s.hits, s.misses);
+            }
+            ImGui::EndMenu();
+        }
+
         ImGui::Text("Layout: %s", getLayoutName().c_str());
         ImGui::SameLine();
         ImGui::ShowHelpMarker("Use Ctrl+L to cycle between layouts.");
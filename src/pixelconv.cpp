@@ -0,0 +1,573 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <doctest.h>
+
+#include "pixelconv.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PIXELCONV_X86
+#include <immintrin.h>
+#endif
+
+static void convertU8ToFloatScalar(const uint8_t* src, float* dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = src[i];
+    }
+}
+
+static void convertU16BEToFloatScalar(const uint8_t* src, float* dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = static_cast<uint16_t>((src[i * 2] << 8) | src[i * 2 + 1]);
+    }
+}
+
+static void convertU16LEToFloatScalar(const uint8_t* src, float* dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = static_cast<uint16_t>(src[i * 2] | (src[i * 2 + 1] << 8));
+    }
+}
+
+static void convertF32BEToFloatScalar(const uint8_t* src, float* dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint32_t bits = (static_cast<uint32_t>(src[i * 4]) << 24) | (src[i * 4 + 1] << 16) | (src[i * 4 + 2] << 8) | src[i * 4 + 3];
+        memcpy(dst + i, &bits, sizeof(float));
+    }
+}
+
+#ifdef PIXELCONV_X86
+__attribute__((target("sse2"))) static void convertU8ToFloatSSE2(const uint8_t* src, float* dst, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_ps(dst + i + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_ps(dst + i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+    }
+    convertU8ToFloatScalar(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void convertU8ToFloatAVX2(const uint8_t* src, float* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m256i lo = _mm256_cvtepu8_epi32(v);
+        __m256i hi = _mm256_cvtepu8_epi32(_mm_srli_si128(v, 8));
+        _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(lo));
+        _mm256_storeu_ps(dst + i + 8, _mm256_cvtepi32_ps(hi));
+    }
+    convertU8ToFloatScalar(src + i, dst + i, n - i);
+}
+
+__attribute__((target("sse2"))) static void convertU16BEToFloatSSE2(const uint8_t* src, float* dst, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)));
+        _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)));
+    }
+    convertU16BEToFloatScalar(src + i * 2, dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void convertU16BEToFloatAVX2(const uint8_t* src, float* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2));
+        v = _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8));
+        __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v));
+        __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1));
+        _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(lo));
+        _mm256_storeu_ps(dst + i + 8, _mm256_cvtepi32_ps(hi));
+    }
+    convertU16BEToFloatScalar(src + i * 2, dst + i, n - i);
+}
+
+__attribute__((target("sse2"))) static void convertU16LEToFloatSSE2(const uint8_t* src, float* dst, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)));
+        _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)));
+    }
+    convertU16LEToFloatScalar(src + i * 2, dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void convertU16LEToFloatAVX2(const uint8_t* src, float* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2));
+        __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v));
+        __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1));
+        _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(lo));
+        _mm256_storeu_ps(dst + i + 8, _mm256_cvtepi32_ps(hi));
+    }
+    convertU16LEToFloatScalar(src + i * 2, dst + i, n - i);
+}
+
+__attribute__((target("sse2"))) static void convertF32BEToFloatSSE2(const uint8_t* src, float* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        // swap the bytes of the 16 bits halves, then the halves
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+    convertF32BEToFloatScalar(src + i * 4, dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void convertF32BEToFloatAVX2(const uint8_t* src, float* dst, size_t n)
+{
+    const __m256i reverse = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(v, reverse));
+    }
+    convertF32BEToFloatScalar(src + i * 4, dst + i, n - i);
+}
+#endif
+
+void convertU8ToFloat(const uint8_t* src, float* dst, size_t n)
+{
+#ifdef PIXELCONV_X86
+    using Conversion = void (*)(const uint8_t*, float*, size_t);
+    static const Conversion conversion = __builtin_cpu_supports("avx2") ? convertU8ToFloatAVX2
+        : __builtin_cpu_supports("sse2")                                 ? convertU8ToFloatSSE2
+                                                                         : convertU8ToFloatScalar;
+    conversion(src, dst, n);
+#else
+    convertU8ToFloatScalar(src, dst, n);
+#endif
+}
+
+void convertU16BEToFloat(const uint8_t* src, float* dst, size_t n)
+{
+#ifdef PIXELCONV_X86
+    using Conversion = void (*)(const uint8_t*, float*, size_t);
+    static const Conversion conversion = __builtin_cpu_supports("avx2") ? convertU16BEToFloatAVX2
+        : __builtin_cpu_supports("sse2")                                 ? convertU16BEToFloatSSE2
+                                                                         : convertU16BEToFloatScalar;
+    conversion(src, dst, n);
+#else
+    convertU16BEToFloatScalar(src, dst, n);
+#endif
+}
+
+void convertU16LEToFloat(const uint8_t* src, float* dst, size_t n)
+{
+#ifdef PIXELCONV_X86
+    using Conversion = void (*)(const uint8_t*, float*, size_t);
+    static const Conversion conversion = __builtin_cpu_supports("avx2") ? convertU16LEToFloatAVX2
+        : __builtin_cpu_supports("sse2")                                 ? convertU16LEToFloatSSE2
+                                                                         : convertU16LEToFloatScalar;
+    conversion(src, dst, n);
+#else
+    convertU16LEToFloatScalar(src, dst, n);
+#endif
+}
+
+namespace {
+// coefficients of the conversion of a Y'CbCr sample to RGB
+struct YCbCrMatrix {
+    float yoffset, yscale;
+    float coffset, cscale;
+    float max;
+
+    YCbCrMatrix(int depth, bool fullRange)
+    {
+        float s = static_cast<float>(1 << (depth - 8));
+        max = static_cast<float>((1 << depth) - 1);
+        coffset = 128.f * s;
+        if (fullRange) {
+            yoffset = 0.f;
+            yscale = 1.f;
+            cscale = 1.f;
+        } else {
+            // Y in [16, 235] and C in [16, 240], at 8 bits
+            yoffset = 16.f * s;
+            yscale = max / (219.f * s);
+            cscale = max / (224.f * s);
+        }
+    }
+};
+}
+
+// BT.601
+static const float kCrR = 1.402f;
+static const float kCbG = -0.344136f;
+static const float kCrG = -0.714136f;
+static const float kCbB = 1.772f;
+
+static void convertYCbCrToRGBScalar(const float* y, const float* cb, const float* cr, bool subsampled,
+    const YCbCrMatrix& m, float* rgb, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        size_t c = subsampled ? i / 2 : i;
+        float yv = (y[i] - m.yoffset) * m.yscale;
+        float cbv = (cb[c] - m.coffset) * m.cscale;
+        float crv = (cr[c] - m.coffset) * m.cscale;
+        rgb[i * 3 + 0] = std::min(std::max(yv + kCrR * crv, 0.f), m.max);
+        rgb[i * 3 + 1] = std::min(std::max(yv + kCbG * cbv + kCrG * crv, 0.f), m.max);
+        rgb[i * 3 + 2] = std::min(std::max(yv + kCbB * cbv, 0.f), m.max);
+    }
+}
+
+#ifdef PIXELCONV_X86
+__attribute__((target("sse2"))) static void convertYCbCrToRGBSSE2(const float* y, const float* cb, const float* cr,
+    bool subsampled, const YCbCrMatrix& m, float* rgb, size_t n)
+{
+    const __m128 yoffset = _mm_set1_ps(m.yoffset);
+    const __m128 yscale = _mm_set1_ps(m.yscale);
+    const __m128 coffset = _mm_set1_ps(m.coffset);
+    const __m128 cscale = _mm_set1_ps(m.cscale);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 max = _mm_set1_ps(m.max);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 cbv, crv;
+        if (subsampled) {
+            // two chroma samples, each one duplicated for its two pixels
+            cbv = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(cb + i / 2)));
+            crv = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(cr + i / 2)));
+            cbv = _mm_unpacklo_ps(cbv, cbv);
+            crv = _mm_unpacklo_ps(crv, crv);
+        } else {
+            cbv = _mm_loadu_ps(cb + i);
+            crv = _mm_loadu_ps(cr + i);
+        }
+        __m128 yv = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(y + i), yoffset), yscale);
+        cbv = _mm_mul_ps(_mm_sub_ps(cbv, coffset), cscale);
+        crv = _mm_mul_ps(_mm_sub_ps(crv, coffset), cscale);
+        __m128 r = _mm_add_ps(yv, _mm_mul_ps(_mm_set1_ps(kCrR), crv));
+        __m128 g = _mm_add_ps(yv, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kCbG), cbv), _mm_mul_ps(_mm_set1_ps(kCrG), crv)));
+        __m128 b = _mm_add_ps(yv, _mm_mul_ps(_mm_set1_ps(kCbB), cbv));
+        r = _mm_min_ps(_mm_max_ps(r, zero), max);
+        g = _mm_min_ps(_mm_max_ps(g, zero), max);
+        b = _mm_min_ps(_mm_max_ps(b, zero), max);
+
+        // interleave: r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3
+        __m128 rg01 = _mm_unpacklo_ps(r, g);
+        __m128 rg23 = _mm_unpackhi_ps(r, g);
+        __m128 b0r1 = _mm_shuffle_ps(b, rg01, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 g1b1 = _mm_shuffle_ps(rg01, b, _MM_SHUFFLE(1, 1, 3, 3));
+        __m128 b2r3 = _mm_shuffle_ps(b, rg23, _MM_SHUFFLE(2, 2, 2, 2));
+        __m128 g3b3 = _mm_shuffle_ps(rg23, b, _MM_SHUFFLE(3, 3, 3, 3));
+        _mm_storeu_ps(rgb + i * 3, _mm_shuffle_ps(rg01, b0r1, _MM_SHUFFLE(2, 0, 1, 0)));
+        _mm_storeu_ps(rgb + i * 3 + 4, _mm_shuffle_ps(g1b1, rg23, _MM_SHUFFLE(1, 0, 2, 0)));
+        _mm_storeu_ps(rgb + i * 3 + 8, _mm_shuffle_ps(b2r3, g3b3, _MM_SHUFFLE(2, 0, 2, 0)));
+    }
+    size_t c = subsampled ? i / 2 : i;
+    convertYCbCrToRGBScalar(y + i, cb + c, cr + c, subsampled, m, rgb + i * 3, n - i);
+}
+#endif
+
+void convertYCbCrToRGB(const float* y, const float* cb, const float* cr, bool subsampled, int depth, bool fullRange,
+    float* rgb, size_t n)
+{
+    YCbCrMatrix m(depth, fullRange);
+#ifdef PIXELCONV_X86
+    using Conversion = void (*)(const float*, const float*, const float*, bool, const YCbCrMatrix&, float*, size_t);
+    static const Conversion conversion = __builtin_cpu_supports("sse2") ? convertYCbCrToRGBSSE2
+                                                                         : convertYCbCrToRGBScalar;
+    conversion(y, cb, cr, subsampled, m, rgb, n);
+#else
+    convertYCbCrToRGBScalar(y, cb, cr, subsampled, m, rgb, n);
+#endif
+}
+
+void convertF32BEToFloat(const uint8_t* src, float* dst, size_t n)
+{
+#ifdef PIXELCONV_X86
+    using Conversion = void (*)(const uint8_t*, float*, size_t);
+    static const Conversion conversion = __builtin_cpu_supports("avx2") ? convertF32BEToFloatAVX2
+        : __builtin_cpu_supports("sse2")                                 ? convertF32BEToFloatSSE2
+                                                                         : convertF32BEToFloatScalar;
+    conversion(src, dst, n);
+#else
+    convertF32BEToFloatScalar(src, dst, n);
+#endif
+}
+
+float halfToFloat(uint16_t h)
+{
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0 && mantissa == 0) {
+        bits = sign;
+    } else if (exponent == 0) {
+        // subnormal, normalized for the float representation
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+size_t getSampleSize(SampleType type)
+{
+    switch (type) {
+    case SampleType::U8:
+    case SampleType::I8:
+        return 1;
+    case SampleType::U16:
+    case SampleType::I16:
+    case SampleType::F16:
+        return 2;
+    case SampleType::U32:
+    case SampleType::I32:
+    case SampleType::F32:
+        return 4;
+    case SampleType::U64:
+    case SampleType::I64:
+    case SampleType::F64:
+        return 8;
+    }
+    return 0;
+}
+
+template <typename T>
+static T loadSample(const uint8_t* src, bool bigEndian)
+{
+    uint8_t bytes[sizeof(T)];
+    if (bigEndian) {
+        for (size_t i = 0; i < sizeof(T); i++) {
+            bytes[i] = src[sizeof(T) - 1 - i];
+        }
+        src = bytes;
+    }
+    T v;
+    memcpy(&v, src, sizeof(T));
+    return v;
+}
+
+template <typename T>
+static void convertSamples(bool bigEndian, const uint8_t* src, size_t srcstep, float* dst, size_t dststep, size_t n)
+{
+    // separate loop for the contiguous case, which the compiler can vectorize
+    if (!bigEndian && srcstep == 1 && dststep == 1) {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = static_cast<float>(loadSample<T>(src + i * sizeof(T), false));
+        }
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        dst[i * dststep] = static_cast<float>(loadSample<T>(src + i * srcstep * sizeof(T), bigEndian));
+    }
+}
+
+static void convertHalfSamples(bool bigEndian, const uint8_t* src, size_t srcstep, float* dst, size_t dststep, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i * dststep] = halfToFloat(loadSample<uint16_t>(src + i * srcstep * 2, bigEndian));
+    }
+}
+
+void convertSamplesToFloat(SampleType type, bool bigEndian, const uint8_t* src, size_t srcstep,
+    float* dst, size_t dststep, size_t n)
+{
+    bool contiguous = srcstep == 1 && dststep == 1;
+    switch (type) {
+    case SampleType::U8:
+        if (contiguous)
+            return convertU8ToFloat(src, dst, n);
+        return convertSamples<uint8_t>(false, src, srcstep, dst, dststep, n);
+    case SampleType::I8:
+        return convertSamples<int8_t>(false, src, srcstep, dst, dststep, n);
+    case SampleType::U16:
+        if (contiguous)
+            return bigEndian ? convertU16BEToFloat(src, dst, n) : convertU16LEToFloat(src, dst, n);
+        return convertSamples<uint16_t>(bigEndian, src, srcstep, dst, dststep, n);
+    case SampleType::I16:
+        return convertSamples<int16_t>(bigEndian, src, srcstep, dst, dststep, n);
+    case SampleType::U32:
+        return convertSamples<uint32_t>(bigEndian, src, srcstep, dst, dststep, n);
+    case SampleType::I32:
+        return convertSamples<int32_t>(bigEndian, src, srcstep, dst, dststep, n);
+    case SampleType::U64:
+        return convertSamples<uint64_t>(bigEndian, src, srcstep, dst, dststep, n);
+    case SampleType::I64:
+        return convertSamples<int64_t>(bigEndian, src, srcstep, dst, dststep, n);
+    case SampleType::F16:
+        return convertHalfSamples(bigEndian, src, srcstep, dst, dststep, n);
+    case SampleType::F32:
+        if (contiguous && !bigEndian) {
+            memcpy(dst, src, n * sizeof(float));
+            return;
+        }
+        if (contiguous)
+            return convertF32BEToFloat(src, dst, n);
+        return convertSamples<float>(bigEndian, src, srcstep, dst, dststep, n);
+    case SampleType::F64:
+        return convertSamples<double>(bigEndian, src, srcstep, dst, dststep, n);
+    }
+}
+
+TEST_CASE("convertU8ToFloat")
+{
+    // odd size to go through the vector loops and the tail
+    uint8_t src[45];
+    for (size_t i = 0; i < sizeof(src); i++) {
+        src[i] = static_cast<uint8_t>(i * 37 + 11);
+    }
+    float dst[45];
+    convertU8ToFloat(src, dst, sizeof(src));
+    for (size_t i = 0; i < sizeof(src); i++) {
+        CHECK(dst[i] == static_cast<float>(src[i]));
+    }
+}
+
+TEST_CASE("convertU16BEToFloat")
+{
+    uint8_t src[45 * 2];
+    for (size_t i = 0; i < sizeof(src); i++) {
+        src[i] = static_cast<uint8_t>(i * 37 + 11);
+    }
+    float dst[45];
+    convertU16BEToFloat(src, dst, 45);
+    for (size_t i = 0; i < 45; i++) {
+        CHECK(dst[i] == static_cast<float>(src[i * 2] * 256 + src[i * 2 + 1]));
+    }
+}
+
+TEST_CASE("convertU16LEToFloat")
+{
+    uint8_t src[45 * 2];
+    for (size_t i = 0; i < sizeof(src); i++) {
+        src[i] = static_cast<uint8_t>(i * 37 + 11);
+    }
+    float dst[45];
+    convertU16LEToFloat(src, dst, 45);
+    for (size_t i = 0; i < 45; i++) {
+        CHECK(dst[i] == static_cast<float>(src[i * 2] + src[i * 2 + 1] * 256));
+    }
+}
+
+TEST_CASE("convertF32BEToFloat")
+{
+    float values[45];
+    uint8_t src[45 * 4];
+    for (size_t i = 0; i < 45; i++) {
+        values[i] = (i * 37.f - 500.f) / 3.f;
+        uint32_t bits;
+        memcpy(&bits, &values[i], 4);
+        for (int b = 0; b < 4; b++) {
+            src[i * 4 + b] = static_cast<uint8_t>(bits >> (24 - 8 * b));
+        }
+    }
+    float dst[45];
+    convertF32BEToFloat(src, dst, 45);
+    for (size_t i = 0; i < 45; i++) {
+        CHECK(dst[i] == values[i]);
+    }
+}
+
+TEST_CASE("convertYCbCrToRGB")
+{
+    SUBCASE("reference colors")
+    {
+        // white, black and the limits of the chroma at 8 bits, video range
+        const float y[] = { 235, 16, 81, 145 };
+        const float cb[] = { 128, 128, 90, 54 };
+        const float cr[] = { 128, 128, 240, 34 };
+        float rgb[12];
+        convertYCbCrToRGB(y, cb, cr, false, 8, false, rgb, 4);
+        CHECK(rgb[0] == doctest::Approx(255.f));
+        CHECK(rgb[1] == doctest::Approx(255.f));
+        CHECK(rgb[2] == doctest::Approx(255.f));
+        CHECK(rgb[3] == 0.f);
+        CHECK(rgb[4] == 0.f);
+        CHECK(rgb[5] == 0.f);
+        // red and green of BT.601 color bars
+        CHECK(rgb[6] == doctest::Approx(255.f).epsilon(0.01));
+        CHECK(rgb[7] == doctest::Approx(0.f).epsilon(0.01));
+        CHECK(rgb[10] == doctest::Approx(255.f).epsilon(0.01));
+    }
+
+    SUBCASE("subsampled, 10 bits")
+    {
+        // odd size to go through the vector loop and the tail
+        float y[11], cb[6], cr[6];
+        for (int i = 0; i < 11; i++) {
+            y[i] = 64.f + i * 80.f;
+        }
+        for (int i = 0; i < 6; i++) {
+            cb[i] = 512.f + (i - 3) * 40.f;
+            cr[i] = 512.f - (i - 3) * 30.f;
+        }
+        float rgb[33];
+        convertYCbCrToRGB(y, cb, cr, true, 10, false, rgb, 11);
+        for (int i = 0; i < 11; i++) {
+            float yv = (y[i] - 64.f) * 1023.f / 876.f;
+            float cbv = (cb[i / 2] - 512.f) * 1023.f / 896.f;
+            float crv = (cr[i / 2] - 512.f) * 1023.f / 896.f;
+            CHECK(rgb[i * 3] == doctest::Approx(std::min(std::max(yv + 1.402f * crv, 0.f), 1023.f)));
+            CHECK(rgb[i * 3 + 1] == doctest::Approx(std::min(std::max(yv - 0.344136f * cbv - 0.714136f * crv, 0.f), 1023.f)));
+            CHECK(rgb[i * 3 + 2] == doctest::Approx(std::min(std::max(yv + 1.772f * cbv, 0.f), 1023.f)));
+        }
+    }
+}
+
+TEST_CASE("halfToFloat")
+{
+    CHECK(halfToFloat(0x0000) == 0.f);
+    CHECK(halfToFloat(0x3c00) == 1.f);
+    CHECK(halfToFloat(0xc000) == -2.f);
+    CHECK(halfToFloat(0x7bff) == 65504.f);
+    // smallest subnormal
+    CHECK(halfToFloat(0x0001) == 0x1p-24f);
+    CHECK(halfToFloat(0x7c00) == std::numeric_limits<float>::infinity());
+}
+
+TEST_CASE("convertSamplesToFloat")
+{
+    SUBCASE("strided big-endian int16")
+    {
+        const uint8_t src[] = { 0xff, 0xfe, 0, 0, 0x01, 0x00, 0, 0 };
+        float dst[4] = { 0, 0, 0, 0 };
+        convertSamplesToFloat(SampleType::I16, true, src, 2, dst, 2, 2);
+        CHECK(dst[0] == -2.f);
+        CHECK(dst[1] == 0.f);
+        CHECK(dst[2] == 256.f);
+    }
+
+    SUBCASE("contiguous little-endian float64")
+    {
+        const double values[] = { 1.5, -3.25 };
+        float dst[2];
+        convertSamplesToFloat(SampleType::F64, false, reinterpret_cast<const uint8_t*>(values), 1, dst, 1, 2);
+        CHECK(dst[0] == 1.5f);
+        CHECK(dst[1] == -3.25f);
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Conversions of decoded samples to the float pixels of the images.
+// On x86, the widest instruction set supported by the CPU is selected at runtime.
+
+void convertU8ToFloat(const uint8_t* src, float* dst, size_t n);
+// n big-endian 16 bits samples (e.g. PNG)
+void convertU16BEToFloat(const uint8_t* src, float* dst, size_t n);
+// n little-endian 16 bits samples (e.g. numpy arrays)
+void convertU16LEToFloat(const uint8_t* src, float* dst, size_t n);
+// n big-endian float samples (e.g. PFM), src can be dst
+void convertF32BEToFloat(const uint8_t* src, float* dst, size_t n);
+
+// n pixels of a row of Y'CbCr samples (BT.601) to interleaved RGB, clamped to the range of the samples
+// the samples have 'depth' bits, in limited (video) range unless fullRange
+// with subsampled, a chroma sample covers two pixels (4:2:0 and 4:2:2)
+void convertYCbCrToRGB(const float* y, const float* cb, const float* cr, bool subsampled, int depth, bool fullRange,
+    float* rgb, size_t n);
+
+// IEEE 754 half-precision sample
+float halfToFloat(uint16_t h);
+
+// types of the samples of raw arrays (numpy arrays, headerless dumps)
+enum class SampleType {
+    U8,
+    I8,
+    U16,
+    I16,
+    U32,
+    I32,
+    U64,
+    I64,
+    F16,
+    F32,
+    F64,
+};
+
+size_t getSampleSize(SampleType type);
+
+// converts n samples read every srcstep samples of src, stored every dststep floats of dst
+// contiguous 8 and 16 bits unsigned little-endian samples go through the vectorized conversions
+void convertSamplesToFloat(SampleType type, bool bigEndian, const uint8_t* src, size_t srcstep,
+    float* dst, size_t dststep, size_t n);
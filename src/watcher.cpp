@@ -46,6 +46,11 @@ void watcher_initialize()
     fileWatcher->watch();
 }
 
+bool watcher_is_enabled()
+{
+    return fileWatcher != nullptr;
+}
+
 void watcher_add_file(const std::string& filename, const std::function<void(const std::string&)>& clb)
 {
     std::error_code ec;
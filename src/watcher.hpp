@@ -5,6 +5,9 @@
 
 void watcher_initialize();
 
+// whether the files are watched (WATCH=1), in which case they can be modified while they are displayed
+bool watcher_is_enabled();
+
 void watcher_add_file(const std::string& filename, const std::function<void(const std::string&)>& clb);
 
 void watcher_check();